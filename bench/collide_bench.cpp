@@ -0,0 +1,113 @@
+// collide_bench.cpp
+//
+
+#include "p_collide.h"
+#include "p_shape.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+//------------------------------------------------------------------------------
+struct query
+{
+    physics::motion motion_a;
+    physics::motion motion_b;
+};
+
+//------------------------------------------------------------------------------
+physics::convex_shape random_convex_shape(std::minstd_rand& engine, std::size_t num_vertices)
+{
+    std::uniform_real_distribution<float> radius(2.f, 8.f);
+    std::uniform_real_distribution<float> angle(0.f, 2.f * math::pi<float>);
+
+    std::vector<vec2> vertices(num_vertices);
+    for (auto& v : vertices) {
+        float a = angle(engine);
+        v = vec2(std::cos(a), std::sin(a)) * radius(engine);
+    }
+    return physics::convex_shape(vertices.data(), vertices.size());
+}
+
+//------------------------------------------------------------------------------
+std::vector<query> random_queries(std::minstd_rand& engine, physics::shape const* shape_a, physics::shape const* shape_b, std::size_t count)
+{
+    std::uniform_real_distribution<float> position(-12.f, 12.f);
+    std::uniform_real_distribution<float> rotation(-math::pi<float>, math::pi<float>);
+
+    std::vector<query> queries;
+    for (std::size_t ii = 0; ii < count; ++ii) {
+        queries.push_back({
+            physics::motion(shape_a, vec2(position(engine), position(engine)), rotation(engine)),
+            physics::motion(shape_b, vec2(position(engine), position(engine)), rotation(engine)),
+        });
+    }
+    return queries;
+}
+
+//------------------------------------------------------------------------------
+//! Returns the average time per query in nanoseconds, `checksum` receives the
+//! sum of contact distances so that results can be compared between kernels.
+double run(physics::collide::contact_func fn, std::vector<query> const& queries, std::size_t num_passes, double& checksum)
+{
+    checksum = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t pass = 0; pass < num_passes; ++pass) {
+        for (auto const& q : queries) {
+            checksum += physics::collide(fn, q.motion_a, q.motion_b).get_contact().distance;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / double(queries.size() * num_passes);
+}
+
+//------------------------------------------------------------------------------
+void compare(char const* name, physics::shape const* shape_a, physics::shape const* shape_b, std::minstd_rand& engine)
+{
+    constexpr std::size_t num_queries = 4096;
+    constexpr std::size_t num_passes = 64;
+
+    std::vector<query> queries = random_queries(engine, shape_a, shape_b, num_queries);
+
+    physics::collide::contact_func specialized = physics::collide::contact_function(shape_a->type(), shape_b->type());
+    physics::collide::contact_func generic = physics::collide::generic_contact_function();
+
+    double specialized_checksum, generic_checksum;
+    double generic_ns = run(generic, queries, num_passes, generic_checksum);
+    double specialized_ns = run(specialized, queries, num_passes, specialized_checksum);
+
+    // closed-form results are not expected to match GJK exactly
+    bool closed_form = physics::collide::has_closed_form(shape_a->type(), shape_b->type());
+
+    char const* kind = closed_form ? "closed-form" : specialized == generic ? "virtual" : "specialized";
+
+    printf("%-18s virtual %8.1f ns  %-11s %8.1f ns  speedup %5.2fx%s\n",
+        name, generic_ns, kind, specialized_ns, generic_ns / specialized_ns,
+        closed_form || generic_checksum == specialized_checksum ? "" : "  (results differ)");
+}
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+int main()
+{
+    std::minstd_rand engine(1);
+
+    physics::box_shape box(vec2(6.f, 3.f));
+    physics::circle_shape circle(1.f);
+    physics::convex_shape convex_8 = random_convex_shape(engine, 8);
+    physics::convex_shape convex_32 = random_convex_shape(engine, 32);
+
+    compare("convex8-convex8", &convex_8, &convex_8, engine);
+    compare("convex32-convex32", &convex_32, &convex_32, engine);
+    compare("box-convex8", &box, &convex_8, engine);
+    compare("convex8-box", &convex_8, &box, engine);
+    compare("box-box", &box, &box, engine);
+    compare("circle-convex8", &circle, &convex_8, engine);
+    compare("circle-circle", &circle, &circle, engine);
+
+    return 0;
+}
@@ -0,0 +1,390 @@
+// physics_bench.cpp
+//
+
+#include "p_compound.h"
+#include "p_material.h"
+#include "p_rigidbody.h"
+#include "p_shape.h"
+#include "p_shapelibrary.h"
+#include "p_world.h"
+
+#include "cm_threadpool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+// ship hull from g_ship.cpp
+vec2 main_body_vertices[] = {
+    {11.0000000, 6.00000000 },
+    {10.0000000, 7.00000000 },
+    {8.00000000, 8.00000000 },
+    {5.00000000, 9.00000000 },
+    {-1.00000000, 9.00000000 },
+    {-7.00000000, 5.00000000 },
+    {-7.00000000, -5.00000000 },
+    {-1.00000000, -9.00000000 },
+    {-1.00000000, -9.00000000 },
+    {5.00000000, -9.00000000 },
+    {8.00000000, -8.00000000 },
+    {10.0000000, -7.00000000 },
+    {11.0000000, -6.00000000 },
+    {11.0000000, 6.00000000 },
+};
+
+vec2 left_engine_vertices[] = {
+    vec2(8, -8) + vec2{-1.00000000, 9.0000000 },
+    vec2(8, -8) + vec2{-1.00000000, 10.0000000 },
+    vec2(8, -8) + vec2{-16.0000000, 10.0000000 },
+    vec2(8, -8) + vec2{-17.0000000, 9.00000000 },
+    vec2(8, -8) + vec2{-17.0000000, 7.00000000 },
+    vec2(8, -8) + vec2{-16.0000000, 6.00000000 },
+    vec2(8, -8) + vec2{-9.0000000, 5.00000000 },
+    vec2(8, -8) + vec2{-7.0000000, 5.00000000 },
+};
+
+vec2 right_engine_vertices[] = {
+    vec2(8, 8) + vec2{-1.00000000, -9.0000000 },
+    vec2(8, 8) + vec2{-1.00000000, -10.0000000 },
+    vec2(8, 8) + vec2{-16.0000000, -10.0000000 },
+    vec2(8, 8) + vec2{-17.0000000, -9.00000000 },
+    vec2(8, 8) + vec2{-17.0000000, -7.00000000 },
+    vec2(8, 8) + vec2{-16.0000000, -6.00000000 },
+    vec2(8, 8) + vec2{-9.0000000, -5.00000000 },
+    vec2(8, 8) + vec2{-7.0000000, -5.00000000 },
+};
+
+constexpr float delta_time = .05f;
+constexpr float projectile_speed = 786.f;
+constexpr std::size_t num_shield_vertices = 64;
+
+//------------------------------------------------------------------------------
+struct options
+{
+    unsigned int seed = 1;
+    std::size_t num_ships = 64;
+    std::size_t num_projectiles = 1024;
+    std::size_t num_shields = 32;
+    std::size_t num_steps = 200;
+    std::size_t num_threads = 0;
+};
+
+//------------------------------------------------------------------------------
+//! Collision categories, same as game::collision_layer
+enum class body_type : uint32_t
+{
+    ship = 1 << 1,
+    shield = 1 << 2,
+    projectile = 1 << 3,
+};
+
+//------------------------------------------------------------------------------
+struct body_info
+{
+    body_type type;
+    std::size_t owner;
+};
+
+//------------------------------------------------------------------------------
+/*
+    Deterministic battle scene
+
+    Ships use the real compound hull and drift through a square arena, some of
+    them are surrounded by a 64-vertex shield which follows its ship as in the
+    game. Projectiles fly in random directions and are respawned at a random
+    position whenever they hit something or leave the arena.
+*/
+class scene
+{
+public:
+    scene(options const& opt)
+        : _engine(opt.seed)
+        , _extent(40.f * std::sqrt(float(std::max<std::size_t>(opt.num_ships, 1))))
+        , _ship_material(.5f, 1.f, 5.f)
+        , _shield_material(0.f, 0.f)
+        , _projectile_material(.5f, 1.f)
+        , _projectile_shape(1.f)
+        , _world(
+            nullptr,
+            [this](physics::rigid_body const* a, physics::rigid_body const* b, physics::collision const& c) { return collide(a, b, c); })
+    {
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+        for (std::size_t ii = 0; ii < opt.num_ships; ++ii) {
+            _ship_shapes.push_back(_shapes.compound({
+                {_shapes.convex(main_body_vertices)},
+                {_shapes.convex(left_engine_vertices), vec2(-8, 8)},
+                {_shapes.convex(right_engine_vertices), vec2(-8, -8)}}));
+
+            physics::rigid_body* body = add_body(_ship_shapes.back().get(), &_ship_material, 1.f, {body_type::ship, ii});
+            body->set_position(vec2(unit(_engine), unit(_engine)) * _extent);
+            body->set_rotation(unit(_engine) * math::pi<float>);
+            body->set_linear_velocity(vec2(unit(_engine), unit(_engine)) * 16.f);
+            body->set_angular_velocity(unit(_engine) * .2f);
+            _ships.push_back(body);
+        }
+
+        for (std::size_t ii = 0; ii < std::min(opt.num_shields, opt.num_ships); ++ii) {
+            vec2 vertices[num_shield_vertices];
+            for (std::size_t jj = 0; jj < num_shield_vertices; ++jj) {
+                float a = float(jj) * 2.f * math::pi<float> / float(num_shield_vertices);
+                vertices[jj] = vec2(std::cos(a), std::sin(a)) * (24.f + 4.f * std::cos(2.f * a));
+            }
+            _shield_shapes.push_back(_shapes.convex(vertices, num_shield_vertices));
+            _shields.push_back(add_body(_shield_shapes.back().get(), &_shield_material, 1.f, {body_type::shield, ii}));
+        }
+
+        for (std::size_t ii = 0; ii < opt.num_projectiles; ++ii) {
+            _projectiles.push_back(add_body(&_projectile_shape, &_projectile_material, 1e-3f, {body_type::projectile, opt.num_ships + ii}));
+            respawn(_projectiles.back());
+        }
+
+        if (opt.num_threads) {
+            _thread_pool = std::make_unique<thread_pool>(opt.num_threads);
+            _world.set_thread_pool(_thread_pool.get());
+        }
+    }
+
+    void step() {
+        // shields follow their owner
+        for (std::size_t ii = 0; ii < _shields.size(); ++ii) {
+            _shields[ii]->set_position(_ships[ii]->get_position());
+            _shields[ii]->set_rotation(_ships[ii]->get_rotation());
+            _shields[ii]->set_linear_velocity(_ships[ii]->get_linear_velocity());
+            _shields[ii]->set_angular_velocity(_ships[ii]->get_angular_velocity());
+        }
+
+        _world.step(delta_time);
+
+        for (auto* body : _projectiles) {
+            vec2 position = body->get_position();
+            if (_hits.count(body) || std::abs(position.x) > _extent || std::abs(position.y) > _extent) {
+                respawn(body);
+            }
+        }
+        _hits.clear();
+    }
+
+    physics::world const& world() const { return _world; }
+
+    //! Hash of the final state of all ships, used to check that changes to
+    //! the physics library do not change simulation results.
+    uint64_t checksum() const {
+        uint64_t hash = 14695981039346656037ull;
+        for (auto const* body : _ships) {
+            float state[] = {
+                body->get_position().x,
+                body->get_position().y,
+                body->get_rotation(),
+                body->get_linear_velocity().x,
+                body->get_linear_velocity().y,
+                body->get_angular_velocity(),
+            };
+            unsigned char const* bytes = reinterpret_cast<unsigned char const*>(state);
+            for (std::size_t ii = 0; ii < sizeof(state); ++ii) {
+                hash = (hash ^ bytes[ii]) * 1099511628211ull;
+            }
+        }
+        return hash;
+    }
+
+protected:
+    std::minstd_rand _engine;
+    float _extent;
+
+    physics::material _ship_material;
+    physics::material _shield_material;
+    physics::material _projectile_material;
+
+    physics::circle_shape _projectile_shape;
+    //! Ships and shields share one shape each as they do in the game
+    physics::shape_library _shapes;
+    std::vector<std::shared_ptr<physics::compound_shape const>> _ship_shapes;
+    std::vector<std::shared_ptr<physics::convex_shape const>> _shield_shapes;
+
+    std::vector<std::unique_ptr<physics::rigid_body>> _bodies;
+    std::vector<physics::rigid_body*> _ships;
+    std::vector<physics::rigid_body*> _shields;
+    std::vector<physics::rigid_body*> _projectiles;
+
+    std::unordered_map<physics::rigid_body const*, body_info> _info;
+    std::unordered_set<physics::rigid_body const*> _hits;
+
+    std::unique_ptr<thread_pool> _thread_pool;
+
+    physics::world _world;
+
+protected:
+    physics::rigid_body* add_body(physics::shape const* shape, physics::material const* material, float mass, body_info info) {
+        _bodies.push_back(std::make_unique<physics::rigid_body>(shape, material, mass));
+        _info[_bodies.back().get()] = info;
+
+        // same filters as game::world::add_body
+        _bodies.back()->set_collision_filter({
+            static_cast<uint32_t>(info.type),
+            ~static_cast<uint32_t>(body_type::projectile),
+            static_cast<uint32_t>(info.owner + 1),
+        });
+
+        _world.add_body(_bodies.back().get());
+        return _bodies.back().get();
+    }
+
+    void respawn(physics::rigid_body* body) {
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+        std::uniform_real_distribution<float> angle(-math::pi<float>, math::pi<float>);
+        float a = angle(_engine);
+        body->set_position(vec2(unit(_engine), unit(_engine)) * _extent);
+        body->set_linear_velocity(vec2(std::cos(a), std::sin(a)) * projectile_speed);
+    }
+
+    bool collide(physics::rigid_body const* body_a, physics::rigid_body const* /*body_b*/, physics::collision const& /*collision*/) {
+        // projectiles are destroyed on impact and do not apply an impulse
+        if (_info.at(body_a).type == body_type::projectile) {
+            _hits.insert(body_a);
+            return false;
+        }
+        return true;
+    }
+};
+
+//------------------------------------------------------------------------------
+//! Return the `p`th percentile of `values` using the nearest rank method
+float percentile(std::vector<float> values, float p)
+{
+    assert(values.size());
+    std::size_t rank = std::size_t(std::ceil(p * .01f * float(values.size())));
+    std::size_t index = std::min(std::max<std::size_t>(rank, 1), values.size()) - 1;
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+//------------------------------------------------------------------------------
+template<typename T> double mean(std::vector<T> const& values)
+{
+    double sum = 0.0;
+    for (T v : values) {
+        sum += double(v);
+    }
+    return values.size() ? sum / double(values.size()) : 0.0;
+}
+
+//------------------------------------------------------------------------------
+void print_timing(char const* name, std::vector<float> const& seconds)
+{
+    std::vector<float> us(seconds.size());
+    std::transform(seconds.begin(), seconds.end(), us.begin(), [](float s) { return s * 1e6f; });
+    printf("%-10s %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+        name, mean(us), percentile(us, 50.f), percentile(us, 90.f), percentile(us, 99.f), percentile(us, 100.f));
+}
+
+//------------------------------------------------------------------------------
+void print_count(char const* name, std::vector<std::size_t> const& counts)
+{
+    std::vector<float> values(counts.begin(), counts.end());
+    printf("%-10s %10.1f %10.0f %10.0f %10.0f %10.0f\n",
+        name, mean(values), percentile(values, 50.f), percentile(values, 90.f), percentile(values, 99.f), percentile(values, 100.f));
+}
+
+//------------------------------------------------------------------------------
+bool parse_options(int argc, char* argv[], options& opt)
+{
+    for (int ii = 1; ii < argc; ++ii) {
+        std::size_t* value = nullptr;
+        if (!strcmp(argv[ii], "-ships")) {
+            value = &opt.num_ships;
+        } else if (!strcmp(argv[ii], "-projectiles")) {
+            value = &opt.num_projectiles;
+        } else if (!strcmp(argv[ii], "-shields")) {
+            value = &opt.num_shields;
+        } else if (!strcmp(argv[ii], "-steps")) {
+            value = &opt.num_steps;
+        } else if (!strcmp(argv[ii], "-threads")) {
+            value = &opt.num_threads;
+        } else if (strcmp(argv[ii], "-seed")) {
+            return false;
+        }
+
+        if (++ii == argc) {
+            return false;
+        } else if (value) {
+            *value = std::strtoul(argv[ii], nullptr, 10);
+        } else {
+            opt.seed = unsigned(std::strtoul(argv[ii], nullptr, 10));
+        }
+    }
+    return opt.num_steps > 0;
+}
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    options opt;
+    if (!parse_options(argc, argv, opt)) {
+        printf("usage: %s [-seed n] [-ships n] [-projectiles n] [-shields n] [-steps n] [-threads n]\n", argv[0]);
+        return 1;
+    }
+
+    scene s(opt);
+
+    std::vector<float> overlap_time, trace_time, integrate_time, step_time;
+    std::vector<std::size_t> pairs, overlaps, traces, iterations, collisions;
+
+    std::size_t max_iterations = 0;
+
+    for (std::size_t ii = 0; ii < opt.num_steps; ++ii) {
+        auto start = std::chrono::steady_clock::now();
+        s.step();
+        step_time.push_back(std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count());
+
+        physics::step_stats const& stats = s.world().get_stats();
+        overlap_time.push_back(stats.overlap_time);
+        trace_time.push_back(stats.trace_time);
+        integrate_time.push_back(stats.integrate_time);
+        pairs.push_back(stats.num_pairs);
+        overlaps.push_back(stats.num_overlaps);
+        traces.push_back(stats.num_traces);
+        iterations.push_back(stats.num_trace_iterations);
+        max_iterations = std::max(max_iterations, stats.max_trace_iterations);
+        collisions.push_back(stats.num_collisions);
+    }
+
+    printf("seed %u, %zu ships, %zu projectiles, %zu shields, %zu steps, %zu threads\n\n",
+        opt.seed, opt.num_ships, opt.num_projectiles, std::min(opt.num_shields, opt.num_ships), opt.num_steps, opt.num_threads);
+
+    printf("%-10s %10s %10s %10s %10s %10s\n", "time (us)", "mean", "p50", "p90", "p99", "max");
+    print_timing("overlaps", overlap_time);
+    print_timing("traces", trace_time);
+    print_timing("integrate", integrate_time);
+    print_timing("step", step_time);
+
+    printf("\n%-10s %10s %10s %10s %10s %10s\n", "count", "mean", "p50", "p90", "p99", "max");
+    print_count("pairs", pairs);
+    print_count("overlaps", overlaps);
+    print_count("traces", traces);
+    print_count("iterations", iterations);
+    print_count("collisions", collisions);
+
+    std::size_t total_traces = 0, total_iterations = 0;
+    for (std::size_t ii = 0; ii < traces.size(); ++ii) {
+        total_traces += traces[ii];
+        total_iterations += iterations[ii];
+    }
+    printf("\niterations per trace: %.2f mean, %zu max\n",
+        total_traces ? double(total_iterations) / double(total_traces) : 0.0, max_iterations);
+
+    printf("\nchecksum %016llx\n", static_cast<unsigned long long>(s.checksum()));
+    return 0;
+}
@@ -94,19 +94,24 @@ void aicontroller::think()
 
     for (auto& weapon : _ship->weapons()) {
         if (!_ship->is_destroyed() && _random.uniform_real() < .01f) {
-            // get a list of all ships in the world
-            std::vector<game::ship*> ships;
-            for (auto* object : get_world()->objects()) {
-                if (object != _ship && object->is_type<ship>()) {
-                    if (!static_cast<ship*>(object)->is_destroyed()) {
-                        ships.push_back(static_cast<ship*>(object));
-                    }
+            // count the ships in the world that can be targeted
+            std::size_t num_targets = 0;
+            for (auto* other : get_world()->objects<ship>()) {
+                if (other != _ship && !other->is_destroyed()) {
+                    ++num_targets;
                 }
             }
 
             // select a random target
-            if (ships.size()) {
-                game::ship* target = ships[_random.uniform_int(ships.size())];
+            if (num_targets) {
+                game::ship* target = nullptr;
+                std::size_t target_index = _random.uniform_int(num_targets);
+                for (auto* other : get_world()->objects<ship>()) {
+                    if (other != _ship && !other->is_destroyed() && !target_index--) {
+                        target = other;
+                        break;
+                    }
+                }
                 if (std::holds_alternative<projectile_weapon_info>(weapon->info())
                     || std::holds_alternative<pulse_weapon_info>(weapon->info())) {
                     weapon->attack_point(target, vec2_zero);
@@ -136,17 +141,27 @@ void aicontroller::think()
             _destroyed_time = time;
         } else if (time - _destroyed_time >= respawn_time) {
             _destroyed_time = time_value::max;
-            get_world()->remove(_ship.get());
 
-            // spawn a new ship to replace the destroyed ship's place
-            _ship = get_world()->spawn<ship>();
-            _ship->set_position(vec2(_random.uniform_real(-320.f, 320.f), _random.uniform_real(-240.f, 240.f)), true);
-            _ship->set_rotation(_random.uniform_real(2.f * math::pi<float>), true);
+            // spawn a new ship to replace the destroyed ship's place, objects
+            // cannot be spawned while other objects are thinking
+            get_world()->defer([this]() {
+                get_world()->remove(_ship.get());
 
+                _ship = get_world()->spawn<ship>();
+                _ship->set_position(vec2(_random.uniform_real(-320.f, 320.f), _random.uniform_real(-240.f, 240.f)), true);
+                _ship->set_rotation(_random.uniform_real(2.f * math::pi<float>), true);
+            });
         }
     }
 }
 
+//------------------------------------------------------------------------------
+object const* aicontroller::think_group() const
+{
+    // controllers modify the subsystems of the ship that they control
+    return _ship ? _ship->think_group() : this;
+}
+
 //------------------------------------------------------------------------------
 vec2 aicontroller::get_position(time_value time) const
 {
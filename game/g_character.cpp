@@ -60,6 +60,13 @@ void character::think()
     }
 }
 
+//------------------------------------------------------------------------------
+object const* character::think_group() const
+{
+    // characters repair the subsystem that they are assigned to
+    return _subsystem ? _subsystem->think_group() : this;
+}
+
 //------------------------------------------------------------------------------
 void character::damage(object* /*inflictor*/, float amount)
 {
@@ -22,6 +22,7 @@ public:
 
     virtual object_type const& type() const override { return _type; }
     virtual void think() override;
+    virtual object const* think_group() const override;
 
     string::view name() const { return _name; }
     void damage(object* inflictor, float amount);
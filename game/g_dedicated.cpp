@@ -0,0 +1,486 @@
+// g_dedicated.cpp
+//
+
+#include "precompiled.h"
+#pragma hdrstop
+
+#include "g_dedicated.h"
+
+#include <chrono>
+#include <cstdio>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace game {
+
+//------------------------------------------------------------------------------
+match::match(dedicated_server& server, std::size_t index)
+    : server_protocol(server.socket(), _clients)
+    , _server(server)
+    , _index(index)
+    // matches run concurrently so each world steps on its match thread only
+    , _world(0)
+    , _worldtime(time_value::zero)
+    , _tick_stats{}
+    , _stop(false)
+{
+    for (auto& cl : _clients) {
+        cl.active = false;
+        cl.local = false;
+        cl.info.name.fill('\0');
+        cl.info.color = color3(1,1,1);
+    }
+
+    _world.set_headless(true);
+    _world.init();
+}
+
+//------------------------------------------------------------------------------
+match::~match()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------------
+void match::start()
+{
+    assert(!_thread.joinable());
+    _thread = std::thread(&match::run, this);
+}
+
+//------------------------------------------------------------------------------
+void match::stop()
+{
+    if (!_thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_one();
+    _thread.join();
+
+    if (_tick_stats.num_ticks) {
+        report_tick_stats();
+    }
+
+    disconnect_clients();
+
+    _world.shutdown();
+}
+
+//------------------------------------------------------------------------------
+void match::post(network::address const& remote, network::message const& message)
+{
+    std::size_t length = message.bytes_remaining();
+    byte const* data = message.read(length);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _packets.push_back({remote, std::vector<byte>(data, data + length)});
+    }
+    _condition.notify_one();
+}
+
+//------------------------------------------------------------------------------
+void match::run()
+{
+    std::vector<packet> packets;
+    time_value previous_time = time_value::current();
+
+    while (true) {
+        {
+            // sleep until the next frame or client timeout unless woken by a packet
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait_for(lock, std::chrono::microseconds(time_to_next_event().to_microseconds()), [this]() {
+                return _stop || _packets.size();
+            });
+
+            if (_stop) {
+                break;
+            }
+
+            std::swap(packets, _packets);
+        }
+
+        for (auto const& p : packets) {
+            network::message_storage message;
+            message.write(p.data.data(), p.data.size());
+            read_packet(p.remote, message);
+        }
+        packets.clear();
+
+        check_timeouts();
+
+        time_value current_time = time_value::current();
+        run_frame(current_time - previous_time);
+        previous_time = current_time;
+
+        send_client_packets();
+    }
+}
+
+//------------------------------------------------------------------------------
+void match::run_frame(time_delta time)
+{
+    // clamp world step size, time in excess of one frame is dropped
+    time_delta dropped = std::max(time - FRAMETIME, time_delta(time_delta::zero));
+    _worldtime += std::min(time, FRAMETIME);
+
+    time_value frame_time = time_value((1 + _world.framenum()) * FRAMETIME);
+    if (_worldtime > frame_time) {
+        time_value start_time = time_value::current();
+
+        _world.run_frame();
+        write_frame();
+
+        time_delta late = _worldtime - frame_time + dropped;
+        time_delta duration = time_value::current() - start_time;
+
+        ++_tick_stats.num_ticks;
+        _tick_stats.total_late += late;
+        _tick_stats.max_late = std::max(_tick_stats.max_late, late);
+        _tick_stats.total_duration += duration;
+        _tick_stats.max_duration = std::max(_tick_stats.max_duration, duration);
+        if (late + duration > FRAMETIME) {
+            ++_tick_stats.num_overruns;
+        }
+
+        if (_tick_stats.num_ticks >= tick_stats_interval) {
+            report_tick_stats();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+time_delta match::time_to_next_event() const
+{
+    time_delta delta = time_value((1 + _world.framenum()) * FRAMETIME) - _worldtime;
+
+    // frames are due at least every FRAMETIME so this only matters if
+    // the client timeout is ever shorter than a frame
+    time_value time = time_value::current();
+    for (auto const& cl : _clients) {
+        if (cl.active) {
+            delta = std::min(delta, cl.netchan.last_received() + client_timeout - time);
+        }
+    }
+
+    return std::max(delta, time_delta(time_delta::zero));
+}
+
+//------------------------------------------------------------------------------
+void match::report_tick_stats()
+{
+    log::message("[match %zu] %zu ticks, %zu overruns, late avg %.2f ms max %.2f ms, tick avg %.2f ms max %.2f ms\n",
+        _index,
+        _tick_stats.num_ticks,
+        _tick_stats.num_overruns,
+        1e3f * (_tick_stats.total_late / double(_tick_stats.num_ticks)).to_seconds(),
+        1e3f * _tick_stats.max_late.to_seconds(),
+        1e3f * (_tick_stats.total_duration / double(_tick_stats.num_ticks)).to_seconds(),
+        1e3f * _tick_stats.max_duration.to_seconds());
+
+    _tick_stats = {};
+}
+
+//------------------------------------------------------------------------------
+void match::read_packet(network::address const& remote, network::message& message)
+{
+    int prefix = message.read_long();
+    if (prefix != network::channel::prefix) {
+        // connect requests are validated and routed by the server
+        message.rewind();
+        client_connect(remote, string::view(message.read_string()), _worldtime);
+        return;
+    }
+
+    process_packet(remote, message);
+}
+
+//------------------------------------------------------------------------------
+void match::write_frame()
+{
+    network::message_storage message;
+
+    _world.write_snapshot(message);
+
+    broadcast(message);
+}
+
+//------------------------------------------------------------------------------
+void match::client_disconnected(std::size_t client)
+{
+    _server.remove_route(_clients[client].netchan.address(), _clients[client].netchan.netport(), _index);
+}
+
+//------------------------------------------------------------------------------
+void match::client_refused(network::address const& remote, word netport)
+{
+    _server.remove_route(remote, netport, _index);
+}
+
+//------------------------------------------------------------------------------
+void match::print_message(string::view message)
+{
+    log::message("[match %zu] %s\n", _index, message.c_str());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//------------------------------------------------------------------------------
+dedicated_server::dedicated_server()
+    : _net_server_name("net_serverName", "Quark Server", config::archive, "local server name")
+{
+    _num_clients.fill(0);
+    log::set(this);
+}
+
+//------------------------------------------------------------------------------
+dedicated_server::~dedicated_server()
+{
+    log::set(nullptr);
+}
+
+//------------------------------------------------------------------------------
+result dedicated_server::init(string::view /*cmdline*/)
+{
+    world::load_sounds();
+
+    if (!_socket.open(network::socket_type::ipv6, PORT_SERVER)) {
+        log::error("failed to open socket on port %d\n", PORT_SERVER);
+        return result::failure;
+    }
+
+    log::message("%s started on port %d\n", string::view(_net_server_name).c_str(), PORT_SERVER);
+    return result::success;
+}
+
+//------------------------------------------------------------------------------
+void dedicated_server::shutdown()
+{
+    for (auto& m : _matches) {
+        m.reset();
+    }
+
+    _socket.close();
+}
+
+//------------------------------------------------------------------------------
+result dedicated_server::run_frame(time_delta /*time*/)
+{
+    get_packets();
+    stop_empty_matches();
+
+    return result::success;
+}
+
+//------------------------------------------------------------------------------
+void dedicated_server::wait() const
+{
+    // matches step their worlds on their own threads so the server only needs
+    // to wake for packets and to stop matches which have become empty
+    _socket.wait(housekeeping_interval);
+}
+
+//------------------------------------------------------------------------------
+void dedicated_server::remove_route(network::address const& remote, word netport, std::size_t match_index)
+{
+    std::lock_guard<std::mutex> lock(_routes_mutex);
+
+    for (auto it = _routes.begin(); it != _routes.end(); ++it) {
+        if (it->remote == remote && it->netport == netport && it->match_index == match_index) {
+            --_num_clients[match_index];
+            _routes.erase(it);
+            return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void dedicated_server::get_packets()
+{
+    network::message_storage message;
+    network::address remote;
+
+    while (_socket.read(remote, message)) {
+        int prefix = message.read_long();
+        if (prefix != network::channel::prefix) {
+            message.rewind();
+            connectionless(remote, message);
+            message.reset();
+            continue;
+        }
+
+        int netport = (word )message.read_short();
+        std::size_t match_index = max_matches;
+
+        {
+            std::lock_guard<std::mutex> lock(_routes_mutex);
+            for (auto const& r : _routes) {
+                if (r.remote == remote && r.netport == netport) {
+                    match_index = r.match_index;
+                    break;
+                }
+            }
+        }
+
+        if (match_index < max_matches && _matches[match_index]) {
+            message.rewind();
+            _matches[match_index]->post(remote, message);
+        }
+
+        message.reset();
+    }
+}
+
+//------------------------------------------------------------------------------
+void dedicated_server::connectionless(network::address const& remote, network::message& message)
+{
+    string::view message_string(message.read_string());
+
+    if (message_string.starts_with("info")) {
+        info_send(remote);
+    } else if (message_string.starts_with("connect")) {
+        client_connect(remote, message, message_string);
+    }
+}
+
+//------------------------------------------------------------------------------
+void dedicated_server::client_connect(network::address const& remote, network::message& message, string::view message_string)
+{
+    int netport = 0, version = 0;
+    char name[64] = {};
+
+    sscanf(message_string, "connect %i %63s %i", &version, name, &netport);
+
+    if (version != PROTOCOL_VERSION) {
+        _socket.printf(remote, "fail \"Bad protocol version: %i\"", version);
+        return;
+    }
+
+    std::size_t match_index;
+
+    {
+        std::lock_guard<std::mutex> lock(_routes_mutex);
+
+        // ensure that this client hasn't already connected
+        for (auto const& r : _routes) {
+            if (r.remote == remote) {
+                return;
+            }
+        }
+
+        match_index = find_match();
+        if (match_index == max_matches) {
+            _socket.printf(remote, "fail \"Server is full\"");
+            return;
+        }
+
+        _routes.push_back({remote, narrow_cast<word>(netport), match_index});
+        ++_num_clients[match_index];
+    }
+
+    if (!_matches[match_index]) {
+        _matches[match_index] = std::make_unique<match>(*this, match_index);
+        _matches[match_index]->start();
+        log::message("[match %zu] started\n", match_index);
+    }
+
+    message.rewind();
+    _matches[match_index]->post(remote, message);
+}
+
+//------------------------------------------------------------------------------
+void dedicated_server::info_send(network::address const& remote)
+{
+    std::lock_guard<std::mutex> lock(_routes_mutex);
+
+    if (find_match() < max_matches) {
+        _socket.printf(remote, "info %s", string::view(_net_server_name).c_str());
+    }
+
+    // full, shhhhh
+}
+
+//------------------------------------------------------------------------------
+std::size_t dedicated_server::find_match()
+{
+    // fill the busiest match with open slots before starting a new one
+    std::size_t best = max_matches;
+    for (std::size_t ii = 0; ii < max_matches; ++ii) {
+        if (!_matches[ii] || _num_clients[ii] >= MAX_PLAYERS) {
+            continue;
+        }
+        if (best == max_matches || _num_clients[ii] > _num_clients[best]) {
+            best = ii;
+        }
+    }
+
+    if (best < max_matches) {
+        return best;
+    }
+
+    for (std::size_t ii = 0; ii < max_matches; ++ii) {
+        if (!_matches[ii]) {
+            return ii;
+        }
+    }
+
+    return max_matches;
+}
+
+//------------------------------------------------------------------------------
+void dedicated_server::stop_empty_matches()
+{
+    for (std::size_t ii = 0; ii < max_matches; ++ii) {
+        if (!_matches[ii]) {
+            continue;
+        }
+
+        // only this thread adds clients to matches so a match which is empty
+        // here cannot gain clients before it is stopped
+        {
+            std::lock_guard<std::mutex> lock(_routes_mutex);
+            if (_num_clients[ii]) {
+                continue;
+            }
+        }
+
+        _matches[ii].reset();
+        log::message("[match %zu] stopped\n", ii);
+    }
+}
+
+//------------------------------------------------------------------------------
+void dedicated_server::print(log::level level, char const* message)
+{
+    // strip color codes, e.g. ^f00 or ^xxx
+    char buffer[LONG_STRING];
+    std::size_t length = 0;
+    for (char const* ptr = message; *ptr && length < countof(buffer) - 1; ++ptr) {
+        if (ptr[0] == '^' && ptr[1] && ptr[2] && ptr[3]) {
+            ptr += 3;
+        } else {
+            buffer[length++] = *ptr;
+        }
+    }
+    buffer[length] = '\0';
+
+    switch (level) {
+        case log::level::message:
+            fputs(buffer, stdout);
+            fflush(stdout);
+            break;
+
+        case log::level::warning:
+            fprintf(stderr, "warning: %s", buffer);
+            break;
+
+        case log::level::error:
+            fprintf(stderr, "error: %s", buffer);
+            break;
+    }
+}
+
+} // namespace game
@@ -0,0 +1,173 @@
+// g_dedicated.h
+//
+
+#pragma once
+
+#include "cm_config.h"
+#include "cm_string.h"
+#include "cm_time.h"
+#include "g_protocol.h"
+#include "g_world.h"
+#include "net_socket.h"
+
+#include <array>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace game {
+
+class dedicated_server;
+
+//------------------------------------------------------------------------------
+/*
+    Independent match hosted by a dedicated server. Each match owns a world and
+    its clients and runs on its own thread. Packets for the match are read from
+    the shared socket by the server and queued for the match thread, replies are
+    written to the shared socket directly by the match thread.
+*/
+class match : protected server_protocol
+{
+public:
+    match(dedicated_server& server, std::size_t index);
+    ~match();
+
+    //! Start stepping the world on the match thread
+    void start();
+    //! Disconnect all clients and wait for the match thread to exit
+    void stop();
+
+    //! Queue a packet from `remote` for processing on the match thread
+    void post(network::address const& remote, network::message const& message);
+
+protected:
+    dedicated_server& _server;
+    std::size_t _index;
+
+    game::world _world;
+    time_value _worldtime;
+
+    std::array<client_t, MAX_PLAYERS> _clients;
+
+    //! Tick timing accumulated since the last report
+    struct tick_statistics
+    {
+        std::size_t num_ticks;
+        //! Ticks which finished after the following tick was due
+        std::size_t num_overruns;
+        //! Time between when a tick was due and when it started
+        time_delta total_late;
+        time_delta max_late;
+        //! Time spent stepping the world and writing snapshots
+        time_delta total_duration;
+        time_delta max_duration;
+    };
+
+    tick_statistics _tick_stats;
+
+    //! Number of ticks between tick statistics reports, one minute
+    constexpr static std::size_t tick_stats_interval = 1200;
+
+    struct packet
+    {
+        network::address remote;
+        std::vector<byte> data;
+    };
+
+    //! Guards `_packets` and `_stop`
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::vector<packet> _packets;
+    bool _stop;
+
+    std::thread _thread;
+
+protected:
+    void run();
+    void run_frame(time_delta time);
+    //! Time until the next world frame is due or a client times out
+    time_delta time_to_next_event() const;
+    //! Log and reset tick statistics
+    void report_tick_stats();
+
+    void read_packet(network::address const& remote, network::message& message);
+    void write_frame();
+
+    // server_protocol
+    virtual void client_disconnected(std::size_t client) override;
+    virtual void client_refused(network::address const& remote, word netport) override;
+    virtual void print_message(string::view message) override;
+};
+
+//------------------------------------------------------------------------------
+/*
+    Headless server which runs worlds for remote clients without a window,
+    renderer or sound device. Matches use the same `server_protocol` as the
+    server in `session` but have no local players. Hosts up to `max_matches`
+    matches which share a single socket; sequenced packets are routed to
+    matches by the remote address and netport of the sender.
+*/
+class dedicated_server : public log
+{
+public:
+    //! Each match holds a world index, see QUARK_HANDLE_SYSTEM_BITS
+    constexpr static std::size_t max_matches = world::max_worlds;
+    //! Maximum time between checks for empty matches when no packets arrive
+    constexpr static time_delta housekeeping_interval = time_delta::from_seconds(1);
+
+public:
+    dedicated_server();
+    ~dedicated_server();
+
+    result init(string::view cmdline);
+    void shutdown();
+
+    //! Read packets from the socket and route them to matches
+    result run_frame(time_delta time);
+    //! Block until packets arrive or housekeeping is due
+    void wait() const;
+
+    network::socket& socket() { return _socket; }
+
+    //! Remove the route for a client that has left `match_index`, may be
+    //! called from any match thread.
+    void remove_route(network::address const& remote, word netport, std::size_t match_index);
+
+protected:
+    network::socket _socket;
+
+    std::array<std::unique_ptr<match>, max_matches> _matches;
+
+    struct route
+    {
+        network::address remote;
+        word netport;
+        std::size_t match_index;
+    };
+
+    //! Guards `_routes` and `_num_clients`
+    std::mutex _routes_mutex;
+    std::vector<route> _routes;
+    std::array<std::size_t, max_matches> _num_clients;
+
+    config::string _net_server_name;
+
+protected:
+    void get_packets();
+
+    void connectionless(network::address const& remote, network::message& message);
+    void client_connect(network::address const& remote, network::message& message, string::view message_string);
+    void info_send(network::address const& remote);
+
+    //! Returns the index of the match that a new client should join
+    std::size_t find_match();
+    //! Stop matches which have no clients
+    void stop_empty_matches();
+
+    virtual void print(log::level level, char const* message) override;
+};
+
+} // namespace game
@@ -1,9 +1,24 @@
 // g_handle.h
 //
 
+#pragma once
+
 #include <cassert>
 #include <climits>
 
+//! Number of handle bits used for the object index, which limits the number of
+//! objects that can exist in a world at the same time. Each remaining bit that
+//! is not used by the index or world index is used by the sequence id.
+#if !defined(QUARK_HANDLE_INDEX_BITS)
+#   define QUARK_HANDLE_INDEX_BITS 16
+#endif
+
+//! Number of handle bits used for the world index, which limits the number of
+//! worlds that can exist at the same time, e.g. matches in a dedicated server.
+#if !defined(QUARK_HANDLE_SYSTEM_BITS)
+#   define QUARK_HANDLE_SYSTEM_BITS 4
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 namespace game {
 
@@ -49,6 +64,7 @@ public:
     template<typename Y> handle& operator=(handle<Y> const& other) {
         static_assert(std::is_base_of<T, Y>::value, "cannot implicitly convert handle to unrelated type");
         _value = other._value;
+        return *this;
     }
 
     //! explicit conversion to bool
@@ -57,22 +73,10 @@ public:
     }
 
     //! retrieve a pointer to referenced object from the game world
-    T const* get() const {
-        if (get_world()) {
-            return get_world()->template get<T>(*this);
-        } else {
-            return nullptr;
-        }
-    }
+    T const* get() const;
 
     //! retrieve a pointer to referenced object from the game world
-    T* get() {
-        if (get_world()) {
-            return get_world()->template get<T>(*this);
-        } else {
-            return nullptr;
-        }
-    }
+    T* get();
 
     //! overloaded pointer to member operator to behave like a raw pointer
     T const* operator->() const { assert(get()); return get(); }
@@ -82,7 +86,7 @@ public:
     //! get the index of the referenced object in the world's object array
     uint64_t get_index() const { return (_value & index_mask) >> index_shift; }
     //! get a pointer to world that contains the referenced object
-    game::world* get_world() const { return game::world::_singletons[get_world_index()]; }
+    game::world* get_world() const;
     //! get the unique sequence number for the referenced object
     uint64_t get_sequence() const { return (_value & sequence_mask) >> sequence_shift; }
 
@@ -95,9 +99,9 @@ protected:
 
 protected:
     //! number of bits used to store the object index
-    static constexpr uint64_t index_bits = 16;
+    static constexpr uint64_t index_bits = QUARK_HANDLE_INDEX_BITS;
     //! number of bits used to store the world index
-    static constexpr uint64_t system_bits = 4;
+    static constexpr uint64_t system_bits = QUARK_HANDLE_SYSTEM_BITS;
     //! number of bits used to store the sequence id, i.e. the bits remaining after index and system
     static constexpr uint64_t sequence_bits = CHAR_BIT * sizeof(uint64_t) - index_bits - system_bits;
 
@@ -115,6 +119,10 @@ protected:
     //! bit mask of the sequence id
     static constexpr uint64_t sequence_mask = ((1ULL << sequence_bits) - 1) << sequence_shift;
 
+    static_assert(index_bits > 0 && index_bits <= 24, "QUARK_HANDLE_INDEX_BITS must be between 1 and 24");
+    static_assert(system_bits > 0 && system_bits <= 16, "QUARK_HANDLE_SYSTEM_BITS must be between 1 and 16");
+    static_assert(sequence_bits >= 24, "QUARK_HANDLE_INDEX_BITS and QUARK_HANDLE_SYSTEM_BITS must leave at least 24 sequence bits");
+
 protected:
     handle(uint64_t index_value, uint64_t system_value, uint64_t sequence_value)
         : _value((index_value << index_shift) | (system_value << system_shift) | (sequence_value << sequence_shift))
@@ -32,23 +32,7 @@ void session::get_packets ()
         }
 
         if (socket == &svs.socket) {
-            int netport = (word )message.read_short();
-
-            for (std::size_t ii = 0; ii < svs.clients.size(); ++ii) {
-                if (svs.clients[ii].local)
-                    continue;
-                if (!svs.clients[ii].active)
-                    continue;
-                if (svs.clients[ii].netchan.address() != remote)
-                    continue;
-                if (svs.clients[ii].netchan.netport() != netport)
-                    continue;
-
-                // found him
-                svs.clients[ii].netchan.process(message);
-                server_packet(message, ii);
-                break;
-            }
+            process_packet(remote, message);
         } else {
             message.read_short(); // skip netport
 
@@ -66,74 +50,22 @@ void session::get_packets ()
     // check for timeouts
     //
 
-    // network uses application time directly so do the same here
-    time_value time = time_value::current();
-    constexpr time_delta timeout = time_delta::from_seconds(10);
-
     if (svs.active) {
-        for (std::size_t ii = 0; ii < svs.clients.size(); ++ii) {
-            if (svs.clients[ii].local || !svs.clients[ii].active) {
-                continue;
-            }
-
-            if (svs.clients[ii].netchan.last_received() + timeout < time) {
-                svs.clients[ii].netchan.write_byte(svc_disconnect);
-                svs.clients[ii].netchan.transmit();
-
-                write_message(va("%s timed out.", svs.clients[ii].info.name.data()));
-                client_disconnect(ii);
-            }
-        }
+        check_timeouts();
     } else if (cls.active) {
-        if (_netchan.last_received() + timeout < time) {
+        // network uses application time directly so do the same here
+        if (_netchan.last_received() + client_timeout < time_value::current()) {
             write_message("Server timed out.");
             stop_client();
         }
     }
 }
 
-//------------------------------------------------------------------------------
-void session::broadcast(std::size_t len, byte const* data)
-{
-    for (auto& cl : svs.clients) {
-        if (!cl.local && cl.active) {
-            cl.netchan.write(data, len);
-        }
-    }
-}
-
-//------------------------------------------------------------------------------
-void session::broadcast(network::message& message)
-{
-    std::size_t length = message.bytes_remaining();
-    byte const* data = message.read(length);
-
-    broadcast(length, data);
-}
-
-//------------------------------------------------------------------------------
-void session::broadcast_print (string::view message)
-{
-    network::message_storage netmsg;
-        
-    netmsg.write_byte( svc_message );
-    netmsg.write_string( message.c_str() );
-
-    broadcast(netmsg);
-}
-
 //------------------------------------------------------------------------------
 void session::send_packets ()
 {
     if (svs.active) {
-        for (auto& cl : svs.clients) {
-            if (cl.local || !cl.active || !cl.netchan.bytes_remaining()) {
-                continue;
-            }
-
-            cl.netchan.transmit();
-            cl.netchan.reset();
-        }
+        send_client_packets();
     } else if (cls.active) {
         client_send();
 
@@ -155,19 +87,6 @@ void session::read_fail(string::view message_string)
     }
 }
 
-//------------------------------------------------------------------------------
-void session::write_info(network::message& message, std::size_t client)
-{
-    message.write_byte( svc_info );
-    message.write_byte( narrow_cast<uint8_t>(client) );
-    message.write_byte( svs.clients[client].active );
-    message.write_string( svs.clients[client].info.name.data() );
-
-    message.write_float( svs.clients[client].info.color.r );
-    message.write_float( svs.clients[client].info.color.g );
-    message.write_float( svs.clients[client].info.color.b );
-}
-
 //------------------------------------------------------------------------------
 void session::read_info(network::message& message)
 {
@@ -185,14 +104,6 @@ void session::read_info(network::message& message)
     svs.clients[client].info.color.r = message.read_float();
     svs.clients[client].info.color.g = message.read_float();
     svs.clients[client].info.color.b = message.read_float();
-
-    // relay info to other clients
-    if (svs.active) {
-        network::message_storage netmsg;
-
-        write_info(netmsg, client);
-        broadcast(netmsg);
-    }
 }
 
 } // namespace game
@@ -105,8 +105,6 @@ void object_type::insert(std::size_t type_index, std::size_t base_index)
 
 //------------------------------------------------------------------------------
 const object_type object::_type;
-physics::material object::_default_material(0.5f, 0.5f);
-physics::circle_shape object::_default_shape(0.5f);
 
 //------------------------------------------------------------------------------
 object::object(object* owner)
@@ -115,13 +113,15 @@ object::object(object* owner)
     , _old_position(vec2_zero)
     , _old_rotation(0)
     , _owner(owner)
-    , _rigid_body(&_default_shape, &_default_material, _default_mass)
+    , _rigid_body(nullptr)
+    , _position(vec2_zero)
+    , _rotation(0)
 {}
 
 //------------------------------------------------------------------------------
 void object::spawn()
 {
-    _random = random(get_world()->get_random());
+    _random = random_generator(get_world()->get_random());
 }
 
 //------------------------------------------------------------------------------
@@ -143,6 +143,12 @@ void object::think()
 {
 }
 
+//------------------------------------------------------------------------------
+object const* object::think_group() const
+{
+    return _owner ? _owner->think_group() : this;
+}
+
 //------------------------------------------------------------------------------
 void object::read_snapshot(network::message const& /*message*/)
 {
@@ -182,7 +188,11 @@ mat3 object::get_inverse_transform(time_value time) const
 //------------------------------------------------------------------------------
 void object::set_position(vec2 position, bool teleport/* = false*/)
 {
-    _rigid_body.set_position(position);
+    if (_rigid_body) {
+        _rigid_body->set_position(position);
+    } else {
+        _position = position;
+    }
     if (teleport) {
         _old_position = position;
     }
@@ -191,7 +201,11 @@ void object::set_position(vec2 position, bool teleport/* = false*/)
 //------------------------------------------------------------------------------
 void object::set_rotation(float rotation, bool teleport/* = false*/)
 {
-    _rigid_body.set_rotation(rotation);
+    if (_rigid_body) {
+        _rigid_body->set_rotation(rotation);
+    } else {
+        _rotation = rotation;
+    }
     if (teleport) {
         _old_rotation =  rotation;
     }
@@ -11,6 +11,7 @@
 #include "p_shape.h"
 
 #include <array>
+#include <cassert>
 
 namespace network {
 class message;
@@ -45,6 +46,8 @@ public:
     }
 
 protected:
+    friend world;
+
     //! Index of this type in the type list
     std::size_t _type_index;
     //! Number of types that are derived directly or indirectly from this type
@@ -91,6 +94,13 @@ public:
     virtual bool touch(object *other, physics::collision const* collision);
     virtual void think();
 
+    //! Return the object which identifies the think group of this object, by
+    //! default the root of its chain of owners. Objects in the same group
+    //! think serially in world order while groups think in parallel, so during
+    //! `think` objects may only modify objects in their own group, any other
+    //! side effects must be deferred with `world::defer`.
+    virtual object const* think_group() const;
+
     virtual void read_snapshot(network::message const& message);
     virtual void write_snapshot(network::message& message) const;
 
@@ -106,22 +116,24 @@ public:
     //! Get frame-interpolated inverse transform matrix
     virtual mat3 get_inverse_transform(time_value time) const;
 
-    physics::rigid_body const& rigid_body() const { return _rigid_body; }
+    //! Returns `true` if this object has a rigid body, see `world::add_body`
+    bool has_rigid_body() const { return _rigid_body != nullptr; }
+    physics::rigid_body const& rigid_body() const { assert(_rigid_body); return *_rigid_body; }
 
     void set_position(vec2 position, bool teleport = false);
     void set_rotation(float rotation, bool teleport = false);
-    void set_linear_velocity(vec2 linear_velocity) { _rigid_body.set_linear_velocity(linear_velocity); }
-    void set_angular_velocity(float angular_velocity) { _rigid_body.set_angular_velocity(angular_velocity); }
+    void set_linear_velocity(vec2 linear_velocity) { assert(_rigid_body); _rigid_body->set_linear_velocity(linear_velocity); }
+    void set_angular_velocity(float angular_velocity) { assert(_rigid_body); _rigid_body->set_angular_velocity(angular_velocity); }
 
-    vec2 get_position() const { return _rigid_body.get_position(); }
-    float get_rotation() const { return _rigid_body.get_rotation(); }
-    mat3 get_transform() const { return _rigid_body.get_transform(); }
-    mat3 get_inverse_transform() const { return _rigid_body.get_inverse_transform(); }
-    vec2 get_linear_velocity() const { return _rigid_body.get_linear_velocity(); }
-    float get_angular_velocity() const { return _rigid_body.get_angular_velocity(); }
+    vec2 get_position() const { return _rigid_body ? _rigid_body->get_position() : _position; }
+    float get_rotation() const { return _rigid_body ? _rigid_body->get_rotation() : _rotation; }
+    mat3 get_transform() const { return _rigid_body ? _rigid_body->get_transform() : mat3::transform(_position, _rotation); }
+    mat3 get_inverse_transform() const { return _rigid_body ? _rigid_body->get_inverse_transform() : mat3::inverse_transform(_position, _rotation); }
+    vec2 get_linear_velocity() const { return _rigid_body ? _rigid_body->get_linear_velocity() : vec2_zero; }
+    float get_angular_velocity() const { return _rigid_body ? _rigid_body->get_angular_velocity() : 0.f; }
 
-    void apply_impulse(vec2 impulse) { _rigid_body.apply_impulse(impulse); }
-    void apply_impulse(vec2 impulse, vec2 position) { _rigid_body.apply_impulse(impulse, position); }
+    void apply_impulse(vec2 impulse) { assert(_rigid_body); _rigid_body->apply_impulse(impulse); }
+    void apply_impulse(vec2 impulse, vec2 position) { assert(_rigid_body); _rigid_body->apply_impulse(impulse, position); }
 
     render::model const* _model;
     color4 _color;
@@ -137,13 +149,15 @@ protected:
     handle<object> _self;
     time_value _spawn_time;
 
-    random _random;
+    random_generator _random;
 
-    physics::rigid_body _rigid_body;
+    //! Physics state, allocated by the world only for objects which are
+    //! physical, see `world::add_body`
+    physics::rigid_body* _rigid_body;
 
-    static physics::material _default_material;
-    static physics::circle_shape _default_shape;
-    constexpr static float _default_mass = 1.0f;
+    //! Position and rotation of objects which do not have a rigid body
+    vec2 _position;
+    float _rotation;
 
 protected:
     game::world* get_world() const { return _self.get_world(); }
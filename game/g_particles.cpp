@@ -51,7 +51,15 @@ void world::clear_particles()
 //------------------------------------------------------------------------------
 void world::add_effect(time_value time, effect_type type, vec2 position, vec2 direction, float strength)
 {
+    if (_deferred_group) {
+        defer([=]() { add_effect(time, type, position, direction, strength); });
+        return;
+    }
+
     write_effect(time, type, position, direction, strength);
+    if (_headless) {
+        return;
+    }
 
     float   r, d;
 
@@ -436,6 +444,15 @@ void world::add_effect(time_value time, effect_type type, vec2 position, vec2 di
 //------------------------------------------------------------------------------
 void world::add_trail_effect(effect_type type, vec2 position, vec2 old_position, vec2 direction, float strength)
 {
+    if (_deferred_group) {
+        defer([=]() { add_trail_effect(type, position, old_position, direction, strength); });
+        return;
+    }
+
+    if (_headless) {
+        return;
+    }
+
     float   r, d;
 
     vec2 lerp = position - old_position;
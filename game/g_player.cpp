@@ -171,17 +171,27 @@ void player::think()
             _destroyed_time = time;
         } else if (time - _destroyed_time >= respawn_time) {
             _destroyed_time = time_value::max;
-            get_world()->remove(_ship.get());
 
-            // spawn a new ship to replace the destroyed ship's place
-            _ship = get_world()->spawn<ship>();
-            _ship->set_position(vec2(_random.uniform_real(-320.f, 320.f), _random.uniform_real(-240.f, 240.f)), true);
-            _ship->set_rotation(_random.uniform_real(2.f * math::pi<float>), true);
+            // spawn a new ship to replace the destroyed ship's place, objects
+            // cannot be spawned while other objects are thinking
+            get_world()->defer([this]() {
+                get_world()->remove(_ship.get());
 
+                _ship = get_world()->spawn<ship>();
+                _ship->set_position(vec2(_random.uniform_real(-320.f, 320.f), _random.uniform_real(-240.f, 240.f)), true);
+                _ship->set_rotation(_random.uniform_real(2.f * math::pi<float>), true);
+            });
         }
     }
 }
 
+//------------------------------------------------------------------------------
+object const* player::think_group() const
+{
+    // controllers modify the subsystems of the ship that they control
+    return _ship ? _ship->think_group() : this;
+}
+
 //------------------------------------------------------------------------------
 vec2 player::get_position(time_value time) const
 {
@@ -293,17 +303,14 @@ void player::update_usercmd(usercmd cmd, time_value time)
 bool player::attack(vec2 position, bool repeat)
 {
     ship* target = nullptr;
-    for (auto obj : get_world()->objects()) {
-        if (!obj->is_type<ship>()) {
-            continue;
-        }
+    get_world()->query_radius<ship>(position, 0.f, [&](ship* obj) {
         mat3 tx = mat3::inverse_transform(obj->get_position(), obj->get_rotation());
         if (!obj->rigid_body().get_shape()->contains_point(position * tx)) {
-            continue;
+            return true;
         }
-        target = static_cast<ship*>(obj);
-        break;
-    }
+        target = obj;
+        return false;
+    });
 
     if (!target) {
         return false;
@@ -330,7 +337,7 @@ bool player::attack(vec2 position, bool repeat)
 //------------------------------------------------------------------------------
 void player::toggle_weapon(int weapon_index, bool toggle_power)
 {
-    if (_ship->weapons().size() > weapon_index) {
+    if (_ship->weapons().size() > static_cast<std::size_t>(weapon_index)) {
         handle<weapon> weapon = _ship->weapons()[weapon_index];
         if (toggle_power) {
             if (weapon->desired_power() < weapon->maximum_power()) {
@@ -32,6 +32,7 @@ public:
     virtual object_type const& type() const override { return _type; }
     virtual void draw(render::system* renderer, time_value time) const;
     virtual void think() override;
+    virtual object const* think_group() const override;
 
     virtual vec2 get_position(time_value time) const override;
     virtual float get_rotation(time_value time) const override;
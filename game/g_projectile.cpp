@@ -22,14 +22,13 @@ projectile::projectile(object* owner, projectile_info info)
     , _info(info)
     , _impact_time(time_value::max)
 {
-    _rigid_body = physics::rigid_body(&_shape, &_material, 1e-3f);
     _channel = pSound->allocate_channel();
 }
 
 //------------------------------------------------------------------------------
 projectile::~projectile()
 {
-    get_world()->remove_body(&_rigid_body);
+    get_world()->remove_body(this);
 
     if (_channel) {
         _channel->stop();
@@ -42,7 +41,7 @@ void projectile::spawn()
 {
     object::spawn();
 
-    get_world()->add_body(this, &_rigid_body);
+    get_world()->add_body(this, &_shape, &_material, 1e-3f);
 }
 
 //------------------------------------------------------------------------------
@@ -58,7 +57,10 @@ void projectile::think()
     }
 
     update_effects();
-    update_sound();
+    // sound channels are not thread-safe
+    get_world()->defer([this]() {
+        update_sound();
+    });
 }
 
 //------------------------------------------------------------------------------
@@ -69,18 +71,19 @@ void projectile::update_homing()
     float bestValue = .5f * math::sqrt2<float>;
     game::object* bestTarget = nullptr;
 
-    for (auto* obj : get_world()->objects()) {
-        if (!obj->is_type<ship>()) {
-            continue;
-        }
+    // only consider targets which can be reached before the fuse expires
+    time_delta remaining = _spawn_time + _info.fuse_time - get_world()->frametime();
+    float range = max(0.f, speed * remaining.to_seconds());
 
+    get_world()->query_cone<ship>(get_position(), direction, .25f * math::pi<float>, range, [&](ship* obj) {
         vec2 displacement = obj->get_position() - get_position();
         float value = displacement.normalize().dot(direction);
         if (value > bestValue) {
             bestValue = value;
             bestTarget = obj;
         }
-    }
+        return true;
+    });
 
     if (bestTarget && bestValue < 0.995f) {
         vec2 target_pos = bestTarget->get_position();
@@ -172,8 +175,6 @@ bool projectile::touch(object *other, physics::collision const* collision)
 //------------------------------------------------------------------------------
 void projectile::draw(render::system* renderer, time_value time) const
 {
-    constexpr time_delta tail_time = time_delta::from_seconds(.04f);
-
     if (time - _info.tail_time > _impact_time) {
         return;
     }
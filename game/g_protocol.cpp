@@ -0,0 +1,270 @@
+// g_protocol.cpp
+//
+
+#include "precompiled.h"
+#pragma hdrstop
+
+#include "g_protocol.h"
+
+#include <cstdio>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace game {
+
+//------------------------------------------------------------------------------
+server_protocol::server_protocol(network::socket& socket, std::array<client_t, MAX_PLAYERS>& clients)
+    : _socket(socket)
+    , _clients(clients)
+{}
+
+//------------------------------------------------------------------------------
+void server_protocol::client_connect(network::address const& remote, string::view message_string, time_value worldtime)
+{
+    int netport = 0, version = 0;
+    char name[64] = {};
+
+    sscanf(message_string, "connect %i %63s %i", &version, name, &netport);
+
+    // ensure that this client hasn't already connected
+    for (auto const& cl : _clients) {
+        if (cl.active && !cl.local && cl.netchan.address() == remote) {
+            return;
+        }
+    }
+
+    if (version != PROTOCOL_VERSION) {
+        _socket.printf(remote, "fail \"Bad protocol version: %i\"", version);
+        client_refused(remote, narrow_cast<word>(netport));
+        return;
+    }
+
+    // find an available client slot
+    std::size_t client = 0;
+    while (client < _clients.size() && _clients[client].active) {
+        ++client;
+    }
+
+    if (client == _clients.size()) {
+        _socket.printf(remote, "fail \"Server is full\"");
+        client_refused(remote, narrow_cast<word>(netport));
+        return;
+    }
+
+    auto& cl = _clients[client];
+
+    cl.active = true;
+    cl.local = false;
+    string::strcpy(cl.info.name, string::view(name));
+    cl.netchan.setup(&_socket, remote, narrow_cast<word>(netport));
+
+    _socket.printf(cl.netchan.address(), "connect %zu %lld", client, worldtime.to_microseconds());
+
+    client_connected(client);
+
+    broadcast_message(va("%s connected.", cl.info.name.data()));
+
+    // broadcast existing client information to new client
+    for (std::size_t ii = 0; ii < _clients.size(); ++ii) {
+        if (ii != client) {
+            write_info(cl.netchan, ii);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::client_disconnect(std::size_t client)
+{
+    network::message_storage message;
+
+    if (!_clients[client].active) {
+        return;
+    }
+
+    _clients[client].active = false;
+    _clients[client].netchan.reset();
+
+    write_info(message, client);
+    broadcast(message);
+
+    client_disconnected(client);
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::disconnect_clients()
+{
+    for (std::size_t ii = 0; ii < _clients.size(); ++ii) {
+        if (_clients[ii].local || !_clients[ii].active) {
+            continue;
+        }
+
+        _clients[ii].netchan.write_byte(svc_disconnect);
+        _clients[ii].netchan.transmit();
+        client_disconnect(ii);
+    }
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::process_packet(network::address const& remote, network::message& message)
+{
+    int netport = (word )message.read_short();
+
+    for (std::size_t ii = 0; ii < _clients.size(); ++ii) {
+        if (_clients[ii].local
+            || !_clients[ii].active
+            || _clients[ii].netchan.address() != remote
+            || _clients[ii].netchan.netport() != netport) {
+            continue;
+        }
+
+        _clients[ii].netchan.process(message);
+        client_packet(message, ii);
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::check_timeouts()
+{
+    // network uses application time directly so do the same here
+    time_value time = time_value::current();
+
+    for (std::size_t ii = 0; ii < _clients.size(); ++ii) {
+        if (_clients[ii].local || !_clients[ii].active) {
+            continue;
+        }
+
+        if (_clients[ii].netchan.last_received() + client_timeout < time) {
+            _clients[ii].netchan.write_byte(svc_disconnect);
+            _clients[ii].netchan.transmit();
+
+            broadcast_message(va("%s timed out.", _clients[ii].info.name.data()));
+            client_disconnect(ii);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::send_client_packets()
+{
+    for (auto& cl : _clients) {
+        if (cl.local || !cl.active || !cl.netchan.bytes_remaining()) {
+            continue;
+        }
+
+        cl.netchan.transmit();
+        cl.netchan.reset();
+    }
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::broadcast(std::size_t length, byte const* data)
+{
+    for (auto& cl : _clients) {
+        if (!cl.local && cl.active) {
+            cl.netchan.write(data, length);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::broadcast(network::message& message)
+{
+    std::size_t length = message.bytes_remaining();
+    byte const* data = message.read(length);
+
+    broadcast(length, data);
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::broadcast_print(string::view message)
+{
+    network::message_storage netmsg;
+
+    netmsg.write_byte(svc_message);
+    netmsg.write_string(message.c_str());
+
+    broadcast(netmsg);
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::write_info(network::message& message, std::size_t client) const
+{
+    message.write_byte(svc_info);
+    message.write_byte(narrow_cast<uint8_t>(client));
+    message.write_byte(_clients[client].active);
+    message.write_string(_clients[client].info.name.data());
+
+    message.write_float(_clients[client].info.color.r);
+    message.write_float(_clients[client].info.color.g);
+    message.write_float(_clients[client].info.color.b);
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::client_packet(network::message& message, std::size_t client)
+{
+    while (message.bytes_remaining()) {
+        switch (message.read_byte()) {
+            case clc_command: {
+                game::usercmd cmd{};
+
+                cmd.cursor = message.read_vector();
+                cmd.action = static_cast<decltype(cmd.action)>(message.read_byte());
+                cmd.buttons = static_cast<decltype(cmd.buttons)>(message.read_byte());
+                cmd.modifiers = static_cast<decltype(cmd.modifiers)>(message.read_byte());
+
+                client_command(client, cmd);
+                break;
+            }
+
+            case clc_disconnect:
+                broadcast_message(va("%s disconnected.", _clients[client].info.name.data()));
+                client_disconnect(client);
+                return;
+
+            case clc_say:
+                broadcast_message(va("^%x%x%x%s^xxx: %s",
+                    (int )(_clients[client].info.color.r * 15.5f),
+                    (int )(_clients[client].info.color.g * 15.5f),
+                    (int )(_clients[client].info.color.b * 15.5f),
+                    _clients[client].info.name.data(), message.read_string()));
+                break;
+
+            case svc_info:
+                read_info(message, client);
+                break;
+
+            default:
+                return;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::read_info(network::message& message, std::size_t client)
+{
+    // clients can only change their own info
+    message.read_byte();
+    message.read_byte();
+
+    string::view name(message.read_string());
+    string::strcpy(_clients[client].info.name, name);
+
+    _clients[client].info.color.r = message.read_float();
+    _clients[client].info.color.g = message.read_float();
+    _clients[client].info.color.b = message.read_float();
+
+    // relay info to other clients
+    network::message_storage netmsg;
+
+    write_info(netmsg, client);
+    broadcast(netmsg);
+}
+
+//------------------------------------------------------------------------------
+void server_protocol::broadcast_message(string::view message)
+{
+    broadcast_print(message);
+    print_message(message);
+}
+
+} // namespace game
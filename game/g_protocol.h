@@ -0,0 +1,121 @@
+// g_protocol.h
+//
+
+#pragma once
+
+#include "cm_string.h"
+#include "cm_time.h"
+#include "g_usercmd.h"
+#include "g_world.h"
+#include "net_channel.h"
+#include "net_socket.h"
+
+#include <array>
+
+#define PROTOCOL_VERSION    4
+
+////////////////////////////////////////////////////////////////////////////////
+namespace game {
+
+//------------------------------------------------------------------------------
+typedef enum netops_e
+{
+    net_bad,
+    net_nop,
+
+    clc_command,    //  player commands
+    clc_disconnect, //  disconnected
+    clc_say,        //  message text
+    clc_upgrade,    //  upgrade command
+
+    svc_disconnect, //  force disconnect
+    svc_message,    //  message from server
+    svc_info,       //  client info
+    svc_snapshot,   //  game snapshot
+    svc_restart     //  game restart
+} netops_t;
+
+//------------------------------------------------------------------------------
+struct userinfo
+{
+    std::array<char, 64> name;
+    color3 color;
+};
+
+//
+// SERVER SIDE DATA
+//
+
+//------------------------------------------------------------------------------
+typedef struct client_s
+{
+    bool active; //!< client is connected and active
+    bool local; //!< client is local (host or hotseat)
+
+    network::channel netchan;
+    game::userinfo info;
+} client_t;
+
+//------------------------------------------------------------------------------
+/*
+    Server side of the client protocol, shared by the server in `session` and
+    the matches of `dedicated_server`. Connects and disconnects remote clients,
+    processes their packets, relays client info and chat, and broadcasts to
+    remote clients. Local clients are skipped. The clients and socket belong to
+    the owner, which is notified of protocol events through virtual functions.
+*/
+class server_protocol
+{
+public:
+    //! Clients are disconnected if no packets are received for this long
+    constexpr static time_delta client_timeout = time_delta::from_seconds(10);
+
+public:
+    server_protocol(network::socket& socket, std::array<client_t, MAX_PLAYERS>& clients);
+    virtual ~server_protocol() {}
+
+    //! Connect a remote client in response to a connectionless connect
+    //! request, `worldtime` is sent to the client in the connect reply.
+    void client_connect(network::address const& remote, string::view message_string, time_value worldtime);
+    void client_disconnect(std::size_t client);
+    //! Send a disconnect to every remote client and disconnect them
+    void disconnect_clients();
+
+    //! Process a sequenced packet from `remote`, `message` is positioned
+    //! after the packet prefix.
+    void process_packet(network::address const& remote, network::message& message);
+    //! Disconnect remote clients from which nothing has been received within
+    //! `client_timeout`
+    void check_timeouts();
+    //! Transmit pending data to each remote client
+    void send_client_packets();
+
+    void broadcast(std::size_t length, byte const* data);
+    void broadcast(network::message& message);
+    void broadcast_print(string::view message);
+
+    void write_info(network::message& message, std::size_t client) const;
+
+protected:
+    network::socket& _socket;
+    std::array<client_t, MAX_PLAYERS>& _clients;
+
+protected:
+    void client_packet(network::message& message, std::size_t client);
+    void read_info(network::message& message, std::size_t client);
+    //! Broadcast `message` to remote clients and pass it to `print_message`
+    void broadcast_message(string::view message);
+
+    //! Called after `client` has connected and been sent its connect reply
+    virtual void client_connected(std::size_t /*client*/) {}
+    //! Called after `client` has been disconnected
+    virtual void client_disconnected(std::size_t /*client*/) {}
+    //! Called after a connect request from `remote` has been refused
+    virtual void client_refused(network::address const& /*remote*/, word /*netport*/) {}
+    //! Called for each command received from `client`
+    virtual void client_command(std::size_t /*client*/, usercmd const& /*cmd*/) {}
+    //! Display or log a message which has been broadcast to remote clients
+    virtual void print_message(string::view message) = 0;
+};
+
+} // namespace game
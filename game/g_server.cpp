@@ -81,17 +81,7 @@ void session::stop_server ()
     svs.active = false;
     svs.local = false;
 
-    for (std::size_t ii = 0; ii < svs.clients.size(); ++ii) {
-        if (svs.clients[ii].local || !svs.clients[ii].active) {
-            continue;
-        }
-
-        client_disconnect(ii);
-
-        svs.clients[ii].netchan.write_byte(svc_disconnect);
-        svs.clients[ii].netchan.transmit();
-        svs.clients[ii].netchan.reset();
-    }
+    disconnect_clients();
 
     svs.socket.close();
 
@@ -106,38 +96,9 @@ void session::server_connectionless(network::address const& remote, network::mes
     if (message_string.starts_with("info")) {
         info_send(remote);
     } else if (message_string.starts_with("connect")) {
-        client_connect(remote, message_string);
-    }
-}
-
-//------------------------------------------------------------------------------
-void session::server_packet(network::message& message, std::size_t client)
-{
-    while (message.bytes_remaining()) {
-        switch (message.read_byte()) {
-            case clc_command:
-                client_command(message, client);
-                break;
-
-            case clc_disconnect:
-                write_message(va("%s disconnected.", svs.clients[client].info.name.data() ));
-                client_disconnect(client);
-                break;
-
-            case clc_say:
-                write_message(va( "^%x%x%x%s^xxx: %s",
-                    (int )(svs.clients[client].info.color.r * 15.5f),
-                    (int )(svs.clients[client].info.color.g * 15.5f),
-                    (int )(svs.clients[client].info.color.b * 15.5f),
-                    svs.clients[client].info.name.data(), message.read_string()));
-                break;
-
-            case svc_info:
-                read_info(message);
-                break;
-
-            default:
-                return;
+        // client has asked for connection
+        if (svs.active) {
+            client_connect(remote, message_string, _worldtime);
         }
     }
 }
@@ -166,93 +127,28 @@ void session::write_frame()
 }
 
 //------------------------------------------------------------------------------
-void session::client_connect(network::address const& remote, string::view message_string)
+void session::client_connected(std::size_t client)
 {
-    // client has asked for connection
-    if (!svs.active) {
-        return;
-    }
-
-    // ensure that this client hasn't already connected
-    for (auto const& cl : svs.clients) {
-        if (cl.active && cl.netchan.address() == remote) {
-            return;
-        }
-    }
-
-    // find an available client slot
-    for (std::size_t ii = 0; ii < svs.clients.size(); ++ii) {
-        if (!svs.clients[ii].active) {
-            return client_connect(remote, message_string, ii);
-        }
-    }
-
-    svs.socket.printf(remote, "fail \"Server is full\"");
+    // init their tank
+    spawn_player(client);
 }
 
 //------------------------------------------------------------------------------
-void session::client_connect(network::address const& remote, string::view message_string, std::size_t client)
+void session::client_command(std::size_t /*client*/, usercmd const& /*cmd*/)
 {
-    auto& cl = svs.clients[client];
-    int netport, version;
-
-    sscanf(message_string, "connect %i %s %i", &version, cl.info.name.data(), &netport);
-
-    if (version != PROTOCOL_VERSION) {
-        svs.socket.printf(remote, "fail \"Bad protocol version: %i\"", version);
-    } else {
-        cl.active = true;
-        cl.local = false;
-        cl.netchan.setup(&svs.socket, remote, narrow_cast<word>(netport));
-
-        svs.socket.printf(cl.netchan.address(), "connect %i %lld", client, _worldtime.to_microseconds());
-
-        // init their tank
-
-        spawn_player(client);
-
-        write_message(va("%s connected.", cl.info.name.data()));
-
-        // broadcast existing client information to new client
-        for (std::size_t ii = 0; ii < svs.clients.size(); ++ii) {
-            if (&cl != &svs.clients[ii]) {
-                write_info(cl.netchan, ii);
-            }
-        }
-    }
-}
-
-//------------------------------------------------------------------------------
-void session::client_disconnect(std::size_t client)
-{
-    network::message_storage message;
-
-    if (!svs.clients[client].active) {
-        return;
-    }
-
-    svs.clients[client].active = false;
-
-    write_info(message, client);
-    broadcast(message);
-}
-
-//------------------------------------------------------------------------------
-void session::client_command(network::message& message, std::size_t /*client*/)
-{
-    game::usercmd cmd{};
-
-    cmd.cursor = message.read_vector();
-    cmd.action = static_cast<decltype(cmd.action)>(message.read_byte());
-    cmd.buttons = static_cast<decltype(cmd.buttons)>(message.read_byte());
-    cmd.modifiers = static_cast<decltype(cmd.modifiers)>(message.read_byte());
-
     //game::tank* player = _world.player(client);
     //if (player) {
     //    player->update_usercmd(cmd);
     //}
 }
 
+//------------------------------------------------------------------------------
+void session::print_message(string::view message)
+{
+    // already broadcast by the server protocol
+    write_message_client(message);
+}
+
 //------------------------------------------------------------------------------
 void session::info_send(network::address const& remote)
 {
@@ -24,7 +24,8 @@ namespace game {
 
 //------------------------------------------------------------------------------
 session::session()
-    : _menu_active(true)
+    : server_protocol(svs.socket, svs.clients)
+    , _menu_active(true)
     , _dedicated(false)
     , _upgrade_frac("g_upgradeFrac", 0.5f, config::archive|config::server, "upgrade fraction")
     , _upgrade_penalty("g_upgradePenalty", 0.2f, config::archive|config::server, "upgrade penalty")
@@ -116,20 +117,11 @@ result session::init (string::view cmdline)
 
     if (cmdline.contains("dedicated")) {
         _dedicated = true;
+        _world.set_headless(true);
         start_server( );
     }
 
-    // sound indices are shared over the network so sounds
-    // need to be registed in the same order on all clients
-    pSound->load_sound("assets/sound/tank_move.wav");
-    pSound->load_sound("assets/sound/tank_idle.wav");
-    pSound->load_sound("assets/sound/tank_explode.wav");
-    pSound->load_sound("assets/sound/turret_move.wav");
-    pSound->load_sound("assets/sound/blaster_fire.wav");
-    pSound->load_sound("assets/sound/blaster_impact.wav");
-    pSound->load_sound("assets/sound/cannon_fire.wav");
-    pSound->load_sound("assets/sound/cannon_impact.wav");
-    pSound->load_sound("assets/sound/missile_flight.wav");
+    world::load_sounds();
 
     return result::success;
 }
@@ -5,6 +5,7 @@
 
 #include "cm_string.h"
 #include "cm_time.h"
+#include "g_protocol.h"
 #include "net_channel.h"
 #include "net_socket.h"
 #include "cm_console.h"
@@ -18,8 +19,6 @@ constexpr const time_delta RESTART_TIME = time_delta::from_seconds(5.0f);
 
 #define SPAWN_BUFFER    32
 
-#define PROTOCOL_VERSION    4
-
 ////////////////////////////////////////////////////////////////////////////////
 namespace game {
 
@@ -58,24 +57,6 @@ constexpr color3 player_colors[] = {
 };
 constexpr std::size_t num_player_colors = countof(player_colors);
 
-//------------------------------------------------------------------------------
-typedef enum netops_e
-{
-    net_bad,
-    net_nop,
-
-    clc_command,    //  player commands
-    clc_disconnect, //  disconnected
-    clc_say,        //  message text
-    clc_upgrade,    //  upgrade command
-
-    svc_disconnect, //  force disconnect
-    svc_message,    //  message from server
-    svc_info,       //  client info
-    svc_snapshot,   //  game snapshot
-    svc_restart     //  game restart
-} netops_t;
-
 //------------------------------------------------------------------------------
 enum class game_mode
 {
@@ -93,27 +74,10 @@ typedef struct  message_s
 
 #define MAX_MESSAGES    32
 
-//------------------------------------------------------------------------------
-struct userinfo
-{
-    std::array<char, 64> name;
-    color3 color;
-};
-
 //
 // SERVER SIDE DATA
 //
 
-//------------------------------------------------------------------------------
-typedef struct client_s
-{
-    bool active; //!< client is connected and active
-    bool local; //!< client is local (host or hotseat)
-
-    network::channel netchan;
-    game::userinfo info;
-} client_t;
-
 //------------------------------------------------------------------------------
 typedef struct server_state_s
 {
@@ -162,7 +126,7 @@ typedef struct client_state_s
 } client_state_t;
 
 //------------------------------------------------------------------------------
-class session : public log
+class session : public log, protected server_protocol
 {
 public:
     session();
@@ -289,30 +253,19 @@ private:
     void write_frame ();
     void send_packets ();
 
-    void broadcast(std::size_t len, byte const* data);
-    void broadcast(network::message& message);
-    void broadcast_print (string::view message);
-
     void server_connectionless(network::address const& remote, network::message& message);
     void client_connectionless(network::address const& remote, network::message& message);
 
-    void server_packet(network::message& message, std::size_t client);
     void client_packet(network::message& message);
 
     void connect_ack(string::view message_string);
 
-    void client_connect(network::address const& remote, string::view message_string);
-    void client_connect(network::address const& remote, string::view message_string, std::size_t client);
-    void client_disconnect(std::size_t client);
-    void client_command(network::message& message, std::size_t client);
-
     void client_send ();
 
     void info_send(network::address const& remote);
     void info_get(network::address const& remote, string::view message_string);
 
     void read_info(network::message& message);
-    void write_info(network::message& message, std::size_t client);
 
     void read_fail(string::view message_string);
 
@@ -324,6 +277,11 @@ private:
 
 protected:
     virtual void print(log::level level, char const* msg) override;
+
+    // server_protocol
+    virtual void client_connected(std::size_t client) override;
+    virtual void client_command(std::size_t client, usercmd const& cmd) override;
+    virtual void print_message(string::view message) override;
 };
 
 } // namespace game
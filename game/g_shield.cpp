@@ -9,6 +9,8 @@
 #include "g_weapon.h"
 #include "p_collide.h"
 
+#include <atomic>
+
 ////////////////////////////////////////////////////////////////////////////////
 namespace game {
 
@@ -16,29 +18,19 @@ const object_type shield::_type(subsystem::_type);
 physics::material shield::_material(0.0f, 0.0f);
 
 //------------------------------------------------------------------------------
-shield::shield(physics::shape const* base, game::ship* owner)
+shield::shield(std::shared_ptr<physics::shape const> base, game::ship* owner)
     : subsystem(owner, {subsystem_type::shields, 2})
-    , _base(base)
+    , _geometry(fit_geometry(std::move(base)))
     , _strength(2)
     , _damage_time(time_value::zero)
+    , _vertices(_geometry->vertices)
     , _prev_strength(_strength)
 {
-    float radius = 32.f;
-
     for (int ii = 0; ii < kNumVertices; ++ii) {
-        float a = ii * (2.f * math::pi<float> / kNumVertices);
-        _vertices[ii] = vec2(std::cos(a), std::sin(a)) * radius;
         _flux[ii] = 0.f;
         _prev_flux[ii] = 0.f;
     }
 
-    for (int ii = 0; ii < 4; ++ii) {
-        step_vertices();
-    }
-
-    _shape = physics::convex_shape(_vertices, kNumVertices);
-    _rigid_body = physics::rigid_body(&_shape, &_material, 1.f);
-
     constexpr color4 schemes[12] = {
         // blue
         color4(.3f, .7f, 1.f, 1.f),
@@ -57,17 +49,17 @@ shield::shield(physics::shape const* base, game::ship* owner)
         color4(.8f, .1f, .0f, .0f),
     };
 
-    static int style = 0;
+    static std::atomic<int> next_style{0};
+    int style = next_style++;
     for (std::size_t ii = 0; ii < _colors.size(); ++ii) {
         _colors[ii] = schemes[(style % 3) * 4 + ii];
     }
-    ++style;
 }
 
 //------------------------------------------------------------------------------
 shield::~shield()
 {
-    get_world()->remove_body(&_rigid_body);
+    get_world()->remove_body(this);
 }
 
 //------------------------------------------------------------------------------
@@ -75,7 +67,7 @@ void shield::spawn()
 {
     object::spawn();
 
-    get_world()->add_body(this, &_rigid_body);
+    get_world()->add_body(this, &_geometry->shape, &_material, 1.f);
 }
 
 //------------------------------------------------------------------------------
@@ -212,14 +204,42 @@ bool shield::damage(vec2 position, float damage)
 }
 
 //------------------------------------------------------------------------------
-void shield::step_vertices()
+std::shared_ptr<shield::geometry const> shield::fit_geometry(std::shared_ptr<physics::shape const> base)
+{
+    // the geometry holds a reference to the base shape so its address stays
+    // unique for as long as the geometry is cached
+    physics::shape const* base_shape = base.get();
+    std::string key = physics::shape_library::make_key("shield", &base_shape, sizeof(base_shape));
+
+    return world::shapes().find_or_create<geometry>(key, [&base]() {
+        auto out = std::make_shared<geometry>();
+        out->base = std::move(base);
+
+        float radius = 32.f;
+
+        for (int ii = 0; ii < kNumVertices; ++ii) {
+            float a = ii * (2.f * math::pi<float> / kNumVertices);
+            out->vertices[ii] = vec2(std::cos(a), std::sin(a)) * radius;
+        }
+
+        for (int ii = 0; ii < 4; ++ii) {
+            step_vertices(out->base.get(), out->vertices);
+        }
+
+        out->shape = physics::convex_shape(out->vertices, kNumVertices);
+        return std::shared_ptr<geometry const>(std::move(out));
+    });
+}
+
+//------------------------------------------------------------------------------
+void shield::step_vertices(physics::shape const* base, vec2* vertices)
 {
     float hull_radius[kNumVertices];
     float prev_radius[kNumVertices];
     float shield_radius[kNumVertices];
 
     for (int ii = 0; ii < kNumVertices; ++ii) {
-        vec2 v = physics::collide::closest_point(_base, _vertices[ii]);
+        vec2 v = physics::collide::closest_point(base, vertices[ii]);
         hull_radius[ii] = v.length();
         shield_radius[ii] = hull_radius[ii] + 4.f;
     }
@@ -245,7 +265,7 @@ void shield::step_vertices()
     }
 
     for (int ii = 0; ii < kNumVertices; ++ii) {
-        _vertices[ii] = _vertices[ii].normalize() * shield_radius[ii];
+        vertices[ii] = vertices[ii].normalize() * shield_radius[ii];
     }
 }
 
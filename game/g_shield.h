@@ -15,7 +15,7 @@ public:
     static const object_type _type;
 
 public:
-    shield(physics::shape const* base, game::ship* owner);
+    shield(std::shared_ptr<physics::shape const> base, game::ship* owner);
     ~shield();
 
     void spawn();
@@ -35,8 +35,19 @@ public:
 
 protected:
     static physics::material _material;
-    physics::shape const* _base;
-    physics::convex_shape _shape;
+
+    static constexpr int kNumVertices = 64;
+
+    //! Shield vertices and collision shape fitted to a hull, shared by all
+    //! shields with the same hull.
+    struct geometry
+    {
+        std::shared_ptr<physics::shape const> base;
+        vec2 vertices[kNumVertices];
+        physics::convex_shape shape;
+    };
+
+    std::shared_ptr<geometry const> _geometry;
 
     std::array<color4, 4> _colors;
 
@@ -46,8 +57,7 @@ protected:
     static constexpr time_delta recharge_delay = time_delta::from_seconds(0.5f); //!< delay after damage before shield recharge
     static constexpr float discharge_rate = 1.f; //!< strength per second discharged when current strength exceeds power level
 
-    static constexpr int kNumVertices = 64;
-    vec2 _vertices[kNumVertices];
+    vec2 const* _vertices; //!< alias of `_geometry->vertices`
     float _flux[kNumVertices];
 
     // for draw interpolation
@@ -55,7 +65,8 @@ protected:
     float _prev_flux[kNumVertices];
 
 protected:
-    void step_vertices();
+    static std::shared_ptr<geometry const> fit_geometry(std::shared_ptr<physics::shape const> base);
+    static void step_vertices(physics::shape const* base, vec2* vertices);
     void step_strength();
 };
 
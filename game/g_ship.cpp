@@ -62,20 +62,18 @@ ship::ship()
     , _shield(nullptr)
     , _dead_time(time_value::max)
     , _is_destroyed(false)
-    , _shape({
-        {std::make_unique<physics::convex_shape>(main_body_vertices)},
-        {std::make_unique<physics::convex_shape>(left_engine_vertices), vec2(-8, 8)},
-        {std::make_unique<physics::convex_shape>(right_engine_vertices), vec2(-8, -8)}})
+    , _shape(world::shapes().compound({
+        {world::shapes().convex(main_body_vertices)},
+        {world::shapes().convex(left_engine_vertices), vec2(-8, 8)},
+        {world::shapes().convex(right_engine_vertices), vec2(-8, -8)}}))
 {
-    _rigid_body = physics::rigid_body(&_shape, &_material, 1.f);
-
     _model = &ship_model;
 }
 
 //------------------------------------------------------------------------------
 ship::~ship()
 {
-    get_world()->remove_body(&_rigid_body);
+    get_world()->remove_body(this);
 }
 
 //------------------------------------------------------------------------------
@@ -83,7 +81,7 @@ void ship::spawn()
 {
     object::spawn();
 
-    get_world()->add_body(this, &_rigid_body);
+    get_world()->add_body(this, _shape.get(), &_material, 1.f);
 
     for (int ii = 0; ii < 3; ++ii) {
         _crew.push_back(get_world()->spawn<character>());
@@ -95,7 +93,7 @@ void ship::spawn()
     _engines = get_world()->spawn<game::engines>(this, engines_info{16.f, .125f, 8.f, .0625f, .5f, .5f});
     _subsystems.push_back(_engines);
 
-    _shield = get_world()->spawn<game::shield>(&_shape, this);
+    _shield = get_world()->spawn<game::shield>(std::shared_ptr<physics::shape const>(_shape), this);
     _subsystems.push_back(_shield);
 
     for (int ii = 0; ii < 2; ++ii) {
@@ -252,22 +250,30 @@ void ship::think()
 
                 get_world()->add_effect(time, effect_type::explosion, v * get_transform(), vec2_zero, .2f * s);
                 if (s * s > t) {
-                    sound::asset _sound_explosion = pSound->load_sound("assets/sound/cannon_impact.wav");
-                    get_world()->add_sound(_sound_explosion, get_position(), .2f * s);
+                    // sound assets are loaded after all objects have thought
+                    // because the sound system is not thread-safe
+                    get_world()->defer([this, s]() {
+                        sound::asset _sound_explosion = pSound->load_sound("assets/sound/cannon_impact.wav");
+                        get_world()->add_sound(_sound_explosion, get_position(), .2f * s);
+                    });
                 }
             }
         } else if (!_is_destroyed) {
-            // add final explosion effect
-            get_world()->add_effect(time, effect_type::explosion, get_position(), vec2_zero);
-            sound::asset _sound_explosion = pSound->load_sound("assets/sound/cannon_impact.wav");
-            get_world()->add_sound(_sound_explosion, get_position());
-
-            // remove all subsystems
-            _crew.clear();
-            _subsystems.clear();
-            _weapons.clear();
-
-            _is_destroyed = true;
+            // destroy the ship after all objects have thought since other
+            // ships check whether this ship has been destroyed
+            get_world()->defer([this, time]() {
+                // add final explosion effect
+                get_world()->add_effect(time, effect_type::explosion, get_position(), vec2_zero);
+                sound::asset _sound_explosion = pSound->load_sound("assets/sound/cannon_impact.wav");
+                get_world()->add_sound(_sound_explosion, get_position());
+
+                // remove all subsystems
+                _crew.clear();
+                _subsystems.clear();
+                _weapons.clear();
+
+                _is_destroyed = true;
+            });
         }
     }
 }
@@ -70,7 +70,8 @@ protected:
     static constexpr time_delta respawn_time = time_delta::from_seconds(3.f);
 
     static physics::material _material;
-    physics::compound_shape _shape;
+    //! Hull shared by all ships
+    std::shared_ptr<physics::compound_shape const> _shape;
 };
 
 } // namespace game
@@ -151,11 +151,11 @@ void weapon::draw(render::system* renderer, time_value time) const
             color4 edge_color = beam_info.color * color4(1.f, 1.f, 1.f, .1f);
 
             if (_beam_shield) {
-                // Trace rigid body using the interpolated position/rotation
-                physics::rigid_body shield_proxy = _beam_shield->rigid_body();
-                shield_proxy.set_position(_beam_shield->get_position(time));
-                shield_proxy.set_rotation(_beam_shield->get_rotation(time));
-                auto tr = physics::trace(&shield_proxy, beam_start, beam_end);
+                // Trace shield shape using the interpolated position/rotation
+                auto tr = physics::trace(_beam_shield->rigid_body().get_shape(),
+                                         _beam_shield->get_position(time),
+                                         _beam_shield->get_rotation(time),
+                                         beam_start, beam_end);
                 renderer->draw_line(2.f, beam_start, tr.get_contact().point, core_color, edge_color);
             } else {
                 renderer->draw_line(2.f, beam_start, beam_end, core_color, edge_color);
@@ -179,11 +179,11 @@ void weapon::draw(render::system* renderer, time_value time) const
             color4 edge_color = pulse_info.color * color4(1.f, 1.f, 1.f, .1f * a);
 
             if (_pulse_shield) {
-                // Trace rigid body using the interpolated position/rotation
-                physics::rigid_body shield_proxy = _pulse_shield->rigid_body();
-                shield_proxy.set_position(_pulse_shield->get_position(time));
-                shield_proxy.set_rotation(_pulse_shield->get_rotation(time));
-                auto tr = physics::trace(&shield_proxy, start, end);
+                // Trace shield shape using the interpolated position/rotation
+                auto tr = physics::trace(_pulse_shield->rigid_body().get_shape(),
+                                         _pulse_shield->get_position(time),
+                                         _pulse_shield->get_rotation(time),
+                                         start, end);
                 renderer->draw_line(2.f, start, tr.get_contact().point, core_color, edge_color);
             } else {
                 renderer->draw_line(2.f, start, end, core_color, edge_color);
@@ -226,39 +226,43 @@ void weapon::think()
 
         if (_projectile_target && time - _last_attack_time <= projectile_info.count * projectile_info.delay) {
             if (_projectile_count < projectile_info.count && _projectile_count * projectile_info.delay <= time - _last_attack_time) {
-                game::projectile* proj = get_world()->spawn<projectile>(_owner.get(), projectile_info.projectile);
-                vec2 start = get_position() * _owner->rigid_body().get_transform();
-                vec2 end = _projectile_target_pos * _projectile_target->rigid_body().get_transform();
-
-                vec2 relative_velocity = _projectile_target->get_linear_velocity();
-                if (projectile_info.projectile.inertia) {
-                    relative_velocity -= _owner->get_linear_velocity();
-                }
+                // spawn and aim the projectile after all objects have thought
+                // since the target's velocity may be modified by its own think
+                get_world()->defer([this, time, &projectile_info]() {
+                    game::projectile* proj = get_world()->spawn<projectile>(_owner.get(), projectile_info.projectile);
+                    vec2 start = get_position() * _owner->rigid_body().get_transform();
+                    vec2 end = _projectile_target_pos * _projectile_target->rigid_body().get_transform();
+
+                    vec2 relative_velocity = _projectile_target->get_linear_velocity();
+                    if (projectile_info.projectile.inertia) {
+                        relative_velocity -= _owner->get_linear_velocity();
+                    }
 
-                // lead target based on relative velocity
-                float dt = intercept_time(end - start, relative_velocity, projectile_info.projectile.speed);
-                if (dt > 0.f) {
-                    end += relative_velocity * dt;
-                }
+                    // lead target based on relative velocity
+                    float dt = intercept_time(end - start, relative_velocity, projectile_info.projectile.speed);
+                    if (dt > 0.f) {
+                        end += relative_velocity * dt;
+                    }
 
-                vec2 dir = (end - start).normalize();
+                    vec2 dir = (end - start).normalize();
 
-                vec2 projectile_velocity = dir * projectile_info.projectile.speed;
-                if (projectile_info.projectile.inertia) {
-                    projectile_velocity += _owner->get_linear_velocity();
-                }
+                    vec2 projectile_velocity = dir * projectile_info.projectile.speed;
+                    if (projectile_info.projectile.inertia) {
+                        projectile_velocity += _owner->get_linear_velocity();
+                    }
 
-                proj->set_position(start, true);
-                proj->set_linear_velocity(projectile_velocity);
-                proj->set_rotation(std::atan2(dir.y, dir.x), true);
+                    proj->set_position(start, true);
+                    proj->set_linear_velocity(projectile_velocity);
+                    proj->set_rotation(std::atan2(dir.y, dir.x), true);
 
-                if (projectile_info.projectile.launch_effect != effect_type::none) {
-                    get_world()->add_effect(time, projectile_info.projectile.launch_effect, start, dir * 2);
-                }
+                    if (projectile_info.projectile.launch_effect != effect_type::none) {
+                        get_world()->add_effect(time, projectile_info.projectile.launch_effect, start, dir * 2);
+                    }
 
-                if (projectile_info.projectile.launch_sound != sound::asset::invalid) {
-                    get_world()->add_sound(projectile_info.projectile.launch_sound, start, projectile_info.projectile.damage);
-                }
+                    if (projectile_info.projectile.launch_sound != sound::asset::invalid) {
+                        get_world()->add_sound(projectile_info.projectile.launch_sound, start, projectile_info.projectile.damage);
+                    }
+                });
 
                 ++_projectile_count;
             }
@@ -283,23 +287,30 @@ void weapon::think()
         }
 
         if (_beam_target && time - _last_attack_time < beam_info.duration) {
-            float t = (time - _last_attack_time) / beam_info.duration;
-            vec2 beam_start = get_position() * _owner->rigid_body().get_transform();
-            vec2 beam_end = (_beam_sweep_end * t + _beam_sweep_start * (1.f - t)) * _beam_target->rigid_body().get_transform();
-            vec2 beam_dir = (beam_end - beam_start).normalize();
-
-            physics::collision c;
-            game::object* obj = get_world()->trace(c, beam_start, beam_end, _owner.get());
-            if (obj && obj->is_type<shield>() && obj->touch(this, &c)) {
-                _beam_shield = static_cast<game::shield*>(obj);
-                _beam_shield->damage(c.point, beam_info.damage * FRAMETIME.to_seconds());
-            } else {
-                _beam_shield = nullptr;
-                get_world()->add_effect(time, effect_type::sparks, beam_end, -beam_dir, beam_info.damage);
-                if (_beam_target->is_type<ship>()) {
-                    static_cast<ship*>(_beam_target.get())->damage(this, beam_end, beam_info.damage * FRAMETIME.to_seconds());
+            // the beam is traced and damage is applied after all objects have
+            // thought since they modify objects outside of this think group
+            get_world()->defer_trace([this, time, &beam_info]() {
+                float t = (time - _last_attack_time) / beam_info.duration;
+                vec2 beam_start = get_position() * _owner->rigid_body().get_transform();
+                vec2 beam_end = (_beam_sweep_end * t + _beam_sweep_start * (1.f - t)) * _beam_target->rigid_body().get_transform();
+                return trace_query{beam_start, beam_end, _owner.get()};
+            }, [this, time, &beam_info](trace_query const& query, trace_result const& result) {
+                vec2 beam_end = query.end;
+                vec2 beam_dir = (query.end - query.start).normalize();
+
+                physics::collision c(result.contact);
+                game::object* obj = result.object;
+                if (obj && obj->is_type<shield>() && obj->touch(this, &c)) {
+                    _beam_shield = static_cast<game::shield*>(obj);
+                    _beam_shield->damage(c.point, beam_info.damage * FRAMETIME.to_seconds());
+                } else {
+                    _beam_shield = nullptr;
+                    get_world()->add_effect(time, effect_type::sparks, beam_end, -beam_dir, beam_info.damage);
+                    if (_beam_target->is_type<ship>()) {
+                        static_cast<ship*>(_beam_target.get())->damage(this, beam_end, beam_info.damage * FRAMETIME.to_seconds());
+                    }
                 }
-            }
+            });
         }
     }
 
@@ -321,35 +332,43 @@ void weapon::think()
 
         if (_pulse_target && time - _last_attack_time <= pulse_info.count * pulse_info.delay) {
             if (_pulse_count < pulse_info.count && _pulse_count * pulse_info.delay <= time - _last_attack_time) {
-                vec2 start = get_position() * _owner->rigid_body().get_transform();
-                vec2 end = _pulse_target_pos * _pulse_target->rigid_body().get_transform();
-                vec2 dir = (end - start).normalize();
-
-                if (pulse_info.launch_effect != effect_type::none) {
-                    get_world()->add_effect(time, pulse_info.launch_effect, start, dir * 2);
-                }
-
-                if (pulse_info.launch_sound != sound::asset::invalid) {
-                    get_world()->add_sound(pulse_info.launch_sound, start, pulse_info.damage);
-                }
-
-                physics::collision c;
-                game::object* obj = get_world()->trace(c, start, end, _owner.get());
-                if (obj && obj->is_type<shield>() && obj->touch(this, &c)) {
-                    _pulse_shield = static_cast<game::shield*>(obj);
-                    if (pulse_info.impact_effect != effect_type::none) {
-                        get_world()->add_effect(time, pulse_info.impact_effect, c.point, -dir, .5f * pulse_info.damage);
+                // the pulse is traced and damage is applied after all objects
+                // have thought since they modify objects outside of this group
+                get_world()->defer_trace([this]() {
+                    vec2 start = get_position() * _owner->rigid_body().get_transform();
+                    vec2 end = _pulse_target_pos * _pulse_target->rigid_body().get_transform();
+                    return trace_query{start, end, _owner.get()};
+                }, [this, time, &pulse_info](trace_query const& query, trace_result const& result) {
+                    vec2 start = query.start;
+                    vec2 end = query.end;
+                    vec2 dir = (end - start).normalize();
+
+                    if (pulse_info.launch_effect != effect_type::none) {
+                        get_world()->add_effect(time, pulse_info.launch_effect, start, dir * 2);
                     }
-                    _pulse_shield->damage(c.point, pulse_info.damage);
-                } else {
-                    _pulse_shield = nullptr;
-                    if (pulse_info.impact_effect != effect_type::none) {
-                        get_world()->add_effect(time, pulse_info.impact_effect, end, -dir, pulse_info.damage);
+
+                    if (pulse_info.launch_sound != sound::asset::invalid) {
+                        get_world()->add_sound(pulse_info.launch_sound, start, pulse_info.damage);
                     }
-                    if (_pulse_target->is_type<ship>()) {
-                        static_cast<ship*>(_pulse_target.get())->damage(this, end, pulse_info.damage);
+
+                    physics::collision c(result.contact);
+                    game::object* obj = result.object;
+                    if (obj && obj->is_type<shield>() && obj->touch(this, &c)) {
+                        _pulse_shield = static_cast<game::shield*>(obj);
+                        if (pulse_info.impact_effect != effect_type::none) {
+                            get_world()->add_effect(time, pulse_info.impact_effect, c.point, -dir, .5f * pulse_info.damage);
+                        }
+                        _pulse_shield->damage(c.point, pulse_info.damage);
+                    } else {
+                        _pulse_shield = nullptr;
+                        if (pulse_info.impact_effect != effect_type::none) {
+                            get_world()->add_effect(time, pulse_info.impact_effect, end, -dir, pulse_info.damage);
+                        }
+                        if (_pulse_target->is_type<ship>()) {
+                            static_cast<ship*>(_pulse_target.get())->damage(this, end, pulse_info.damage);
+                        }
                     }
-                }
+                });
 
                 ++_pulse_count;
             }
@@ -396,7 +415,7 @@ void weapon::cancel()
 }
 
 //------------------------------------------------------------------------------
-weapon_info const& weapon::by_random(random& r)
+weapon_info const& weapon::by_random(random_generator& r)
 {
     return _types[r.uniform_int(_types.size())];
 }
@@ -81,7 +81,7 @@ public:
     bool is_attacking() const { return _is_attacking; }
     bool is_repeating() const { return _is_repeating; }
 
-    static weapon_info const& by_random(random& r);
+    static weapon_info const& by_random(random_generator& r);
 
 protected:
     weapon_info _info;
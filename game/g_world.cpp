@@ -6,24 +6,36 @@
 
 #include "g_aicontroller.h"
 #include "g_projectile.h"
+#include "g_shield.h"
 #include "g_ship.h"
 #include "g_player.h"
 #include "p_collide.h"
 #include "p_trace.h"
 
 #include <algorithm>
-#include <set>
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace game {
 
 std::array<world*, world::max_worlds> world::_singletons{};
+physics::shape_library world::_shapes;
+thread_local world::think_group* world::_deferred_group = nullptr;
 
 //------------------------------------------------------------------------------
 world::world()
-    : _sequence(0)
+    : world(thread_pool::default_num_threads())
+{}
+
+//------------------------------------------------------------------------------
+world::world(std::size_t num_worker_threads)
+    : _bodies(sizeof(physics::rigid_body))
+    , _free_slot(no_slot)
+    , _type_slots_dirty{}
+    , _sequence(0)
+    , _headless(false)
+    , _thread_pool(num_worker_threads)
     , _physics(
-        std::bind(&world::physics_filter_callback, this, std::placeholders::_1, std::placeholders::_2),
+        nullptr,
         std::bind(&world::physics_collide_callback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3))
 {
     for (_index = 0; _index < max_worlds; ++_index) {
@@ -34,6 +46,8 @@ world::world()
     }
 
     assert(_index < max_worlds);
+
+    _physics.set_thread_pool(&_thread_pool);
 }
 
 //------------------------------------------------------------------------------
@@ -83,7 +97,25 @@ void world::reset()
 //------------------------------------------------------------------------------
 void world::clear()
 {
+    // destroy objects individually so that handles to objects which have
+    // already been destroyed are invalid during destruction of the others
+    for (std::size_t ii = 0; ii < _objects.size(); ++ii) {
+        if (_objects[ii]) {
+            free_slot(ii);
+        }
+    }
+
     _objects.clear();
+    _slots.clear();
+    _free_slot = no_slot;
+    _sequence_slots.clear();
+    for (auto& slots : _type_slots) {
+        slots.clear();
+    }
+    for (auto& positions : _type_positions) {
+        positions.clear();
+    }
+    _type_slots_dirty.fill(false);
     // assign with empty queue because std::queue has no clear method
     _removed = std::queue<handle<game::object>>{};
 
@@ -112,9 +144,131 @@ object_range<object> world::objects()
 //------------------------------------------------------------------------------
 void world::remove(handle<object> object)
 {
+    if (_deferred_group) {
+        defer([this, object]() { remove(object); });
+        return;
+    }
     _removed.push(object);
 }
 
+//------------------------------------------------------------------------------
+void world::defer(std::function<void()>&& fn)
+{
+    if (_deferred_group) {
+        _deferred_group->commands.push_back(std::move(fn));
+    } else {
+        fn();
+    }
+}
+
+//------------------------------------------------------------------------------
+std::size_t world::allocate_slot()
+{
+    if (_free_slot != no_slot) {
+        std::size_t index = _free_slot;
+        _free_slot = _slots[index].next_free;
+        return index;
+    }
+
+    assert(_objects.size() < max_objects);
+    _objects.emplace_back();
+    _slots.push_back({0, no_slot});
+    return _objects.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+void world::free_slot(std::size_t index)
+{
+    remove_type_slots(index);
+    _sequence_slots.erase(_slots[index].sequence);
+    _slots[index].sequence = 0;
+    // move the object out of the array before destroying it in case its
+    // destructor spawns other objects and the array is reallocated
+    object_ptr obj = std::move(_objects[index]);
+    obj.reset();
+
+    _slots[index].next_free = _free_slot;
+    _free_slot = index;
+}
+
+//------------------------------------------------------------------------------
+void world::flush_removed()
+{
+    while (_removed.size()) {
+        if (_removed.front()) {
+            free_slot(_removed.front().get_index());
+        }
+        _removed.pop();
+    }
+}
+
+//------------------------------------------------------------------------------
+block_pool& world::object_pool(object_type const& type, std::size_t size)
+{
+    auto& pool = _pools[type._type_index];
+    if (!pool) {
+        pool = std::make_unique<block_pool>(size);
+    }
+    // types which are spawned must define their own type info
+    assert(pool->block_size() >= size && "invalid type info");
+    return *pool;
+}
+
+//------------------------------------------------------------------------------
+void world::insert_type_slots(std::size_t index)
+{
+    object_type const& type = _objects[index]->type();
+    for (std::size_t ii = 1; ii < object_type::_num_types; ++ii) {
+        if (type.is_type(*object_type::_types[ii])) {
+            auto& positions = _type_positions[ii];
+            if (positions.size() <= index) {
+                positions.resize(_objects.size(), no_slot);
+            }
+            positions[index] = _type_slots[ii].size();
+            _type_slots[ii].push_back(index);
+            _type_slots_dirty[ii] = true;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void world::remove_type_slots(std::size_t index)
+{
+    object_type const& type = _objects[index]->type();
+    for (std::size_t ii = 1; ii < object_type::_num_types; ++ii) {
+        if (type.is_type(*object_type::_types[ii])) {
+            auto& slots = _type_slots[ii];
+            auto& positions = _type_positions[ii];
+            std::size_t position = positions[index];
+            assert(position < slots.size() && slots[position] == index);
+
+            // move the last slot in the list into the removed slot's position
+            slots[position] = slots.back();
+            positions[slots[position]] = position;
+            slots.pop_back();
+            positions[index] = no_slot;
+            _type_slots_dirty[ii] = true;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void world::sort_type_slots()
+{
+    for (std::size_t ii = 1; ii < object_type::_num_types; ++ii) {
+        if (!_type_slots_dirty[ii]) {
+            continue;
+        }
+
+        auto& slots = _type_slots[ii];
+        std::sort(slots.begin(), slots.end());
+        for (std::size_t jj = 0; jj < slots.size(); ++jj) {
+            _type_positions[ii][slots[jj]] = jj;
+        }
+        _type_slots_dirty[ii] = false;
+    }
+}
+
 //------------------------------------------------------------------------------
 void world::draw(render::system* renderer, time_value time) const
 {
@@ -138,12 +292,22 @@ void world::run_frame()
 
     ++_framenum;
 
-    while (_removed.size()) {
-        if (_removed.front()) {
-            _objects[_removed.front().get_index()] = nullptr;
-        }
-        _removed.pop();
-    }
+    flush_removed();
+
+    // typed iteration during think visits objects in world order
+    sort_type_slots();
+
+    think_objects();
+
+    _physics.step(FRAMETIME.to_seconds());
+}
+
+//------------------------------------------------------------------------------
+void world::think_objects()
+{
+    // group objects by think group in world order
+    std::size_t num_groups = 0;
+    _think_group_index.assign(_objects.size(), no_slot);
 
     for (std::size_t ii = 0; ii < _objects.size(); ++ii) {
         // objects array is sparse
@@ -156,24 +320,60 @@ void world::run_frame()
             continue;
         }
 
-        _objects[ii]->think();
+        std::size_t group = _objects[ii]->think_group()->_self.get_index();
+        if (_think_group_index[group] == no_slot) {
+            if (num_groups == _think_groups.size()) {
+                _think_groups.emplace_back();
+            }
+            _think_group_index[group] = num_groups++;
+        }
+        _think_groups[_think_group_index[group]].objects.push_back(_objects[ii].get());
+    }
 
-        _objects[ii]->_old_position = _objects[ii]->get_position();
-        _objects[ii]->_old_rotation = _objects[ii]->get_rotation();
+    // moving bodies only modifies the body store until all objects have
+    // thought, the bounding volume tree is updated afterwards
+    _physics.begin_deferred_updates();
+
+    _thread_pool.parallel_for(num_groups, [this](std::size_t index) {
+        _deferred_group = &_think_groups[index];
+        for (object* obj : _think_groups[index].objects) {
+            obj->think();
+
+            obj->_old_position = obj->get_position();
+            obj->_old_rotation = obj->get_rotation();
+        }
+        _deferred_group = nullptr;
+    });
+
+    _physics.end_deferred_updates();
+
+    // trace deferred segments from all groups in a single batch
+    _trace_queries.clear();
+    for (std::size_t ii = 0; ii < num_groups; ++ii) {
+        _think_groups[ii].first_trace = _trace_queries.size();
+        for (auto& query : _think_groups[ii].traces) {
+            _trace_queries.push_back(query());
+        }
+        _think_groups[ii].traces.clear();
     }
 
-    _physics.step(FRAMETIME.to_seconds());
+    _trace_results.resize(_trace_queries.size());
+    trace(_trace_queries.data(), _trace_queries.size(), _trace_results.data());
+
+    // apply deferred commands serially in group order
+    for (std::size_t ii = 0; ii < num_groups; ++ii) {
+        for (auto& fn : _think_groups[ii].commands) {
+            fn();
+        }
+        _think_groups[ii].commands.clear();
+        _think_groups[ii].objects.clear();
+    }
 }
 
 //------------------------------------------------------------------------------
 void world::read_snapshot(network::message& message)
 {
-    while (_removed.size()) {
-        if (_removed.front()) {
-            _objects[_removed.front().get_index()] = nullptr;
-        }
-        _removed.pop();
-    }
+    flush_removed();
 
     while (message.bytes_remaining()) {
         message_type type = static_cast<message_type>(message.read_byte());
@@ -269,79 +469,175 @@ void world::write_effect(time_value time, effect_type type, vec2 position, vec2
 //------------------------------------------------------------------------------
 game::object* world::trace(physics::contact& contact, vec2 start, vec2 end, game::object const* ignore) const
 {
-    struct candidate {
-        float fraction;
-        physics::contact contact;
-        game::object* object;
+    trace_query query{start, end, ignore};
+    trace_result result;
 
-        bool operator<(candidate const& other) const {
-            return fraction < other.fraction;
-        }
-    };
+    trace(&query, 1, &result);
+    if (result.object) {
+        contact = result.contact;
+    }
+    return result.object;
+}
 
-    std::set<candidate> candidates;
-    for (auto& other : _physics_objects) {
-        if (other.second == ignore || other.second->_owner == ignore) {
-            continue;
+//------------------------------------------------------------------------------
+void world::trace(trace_query const* queries, std::size_t num_queries, trace_result* results) const
+{
+    constexpr std::size_t batch_size = 64;
+    physics::ray rays[batch_size];
+    physics::ray_hit hits[batch_size];
+
+    for (std::size_t first = 0; first < num_queries; first += batch_size) {
+        std::size_t count = std::min(batch_size, num_queries - first);
+
+        for (std::size_t ii = 0; ii < count; ++ii) {
+            trace_query const& query = queries[first + ii];
+            // segments hit every layer except the group of the ignored object,
+            // which matches the group assigned to bodies in `add_body`
+            game::object const* group_owner = !query.ignore ? nullptr
+                                            : query.ignore->_owner ? query.ignore->_owner.get()
+                                            : query.ignore;
+            rays[ii].start = query.start;
+            rays[ii].end = query.end;
+            rays[ii].filter = {
+                0,
+                UINT32_MAX,
+                group_owner ? group_owner->get_sequence() + 1 : 0,
+            };
         }
 
-        auto tr = physics::trace(other.first, start, end);
-        if (tr.get_fraction() < 1.0f) {
-            candidates.insert(candidate{
-                tr.get_fraction(),
-                tr.get_contact(),
-                other.second}
-            );
+        _physics.raycast(rays, count, hits);
+
+        for (std::size_t ii = 0; ii < count; ++ii) {
+            results[first + ii].object = hits[ii].body ? _physics_objects.at(hits[ii].body) : nullptr;
+            results[first + ii].contact = hits[ii].contact;
         }
     }
+}
 
-    if (candidates.size()) {
-        contact = candidates.begin()->contact;
-        return candidates.begin()->object;
+//------------------------------------------------------------------------------
+void world::defer_trace(std::function<trace_query()>&& query, std::function<void(trace_query const&, trace_result const&)>&& fn)
+{
+    if (_deferred_group) {
+        think_group* group = _deferred_group;
+        std::size_t index = group->traces.size();
+        group->traces.push_back(std::move(query));
+        group->commands.push_back([this, group, index, fn = std::move(fn)]() {
+            std::size_t result_index = group->first_trace + index;
+            fn(_trace_queries[result_index], _trace_results[result_index]);
+        });
+    } else {
+        trace_query q = query();
+        trace_result result;
+        trace(&q, 1, &result);
+        fn(q, result);
     }
+}
 
-    return nullptr;
+//------------------------------------------------------------------------------
+void world::load_sounds()
+{
+    // sound indices are shared over the network so sounds
+    // need to be registed in the same order on all clients
+    pSound->load_sound("assets/sound/tank_move.wav");
+    pSound->load_sound("assets/sound/tank_idle.wav");
+    pSound->load_sound("assets/sound/tank_explode.wav");
+    pSound->load_sound("assets/sound/turret_move.wav");
+    pSound->load_sound("assets/sound/blaster_fire.wav");
+    pSound->load_sound("assets/sound/blaster_impact.wav");
+    pSound->load_sound("assets/sound/cannon_fire.wav");
+    pSound->load_sound("assets/sound/cannon_impact.wav");
+    pSound->load_sound("assets/sound/missile_flight.wav");
 }
 
 //------------------------------------------------------------------------------
 void world::add_sound(sound::asset sound_asset, vec2 position, float volume)
 {
+    if (_deferred_group) {
+        defer([=]() { add_sound(sound_asset, position, volume); });
+        return;
+    }
+
     write_sound(sound_asset, position, volume);
+    if (_headless) {
+        return;
+    }
     pSound->play(sound_asset, vec3(position), volume, 1.0f);
 }
 
 //------------------------------------------------------------------------------
-void world::add_body(game::object* owner, physics::rigid_body* body)
+physics::collision_filter world::query_filter(object_type const& type) const
 {
-    _physics.add_body(body);
-    _physics_objects[body] = owner;
+    std::pair<collision_layer, object_type const*> const layers[] = {
+        {collision_layer::projectile, &projectile::_type},
+        {collision_layer::shield, &shield::_type},
+        {collision_layer::ship, &ship::_type},
+    };
+
+    // objects which are not of any of the types above belong to the object
+    // layer, see `add_body`
+    collision_layer mask = collision_layer::object;
+    for (auto const& layer : layers) {
+        if (type.is_type(*layer.second)) {
+            mask = layer.first;
+            break;
+        } else if (layer.second->is_type(type)) {
+            mask |= layer.first;
+        }
+    }
+
+    return {0, static_cast<uint32_t>(mask), 0};
 }
 
 //------------------------------------------------------------------------------
-void world::remove_body(physics::rigid_body* body)
+physics::rigid_body& world::add_body(game::object* owner, physics::shape const* shape, physics::material const* material, float mass)
 {
-    _physics.remove_body(body);
-    _physics_objects.erase(body);
+    static_assert(alignof(physics::rigid_body) <= block_pool::block_alignment,
+                  "'add_body': 'physics::rigid_body' is over-aligned");
+    assert(!owner->_rigid_body && "object already has a rigid body");
+
+    physics::rigid_body* body = new (_bodies.allocate()) physics::rigid_body(shape, material, mass);
+    body->set_position(owner->_position);
+    body->set_rotation(owner->_rotation);
+    owner->_rigid_body = body;
+
+    collision_layer category = owner->is_type<projectile>() ? collision_layer::projectile
+                             : owner->is_type<shield>() ? collision_layer::shield
+                             : owner->is_type<ship>() ? collision_layer::ship
+                             : collision_layer::object;
+
+    // projectiles handle their own impacts and are never hit by other objects
+    collision_layer mask = ~collision_layer::projectile;
+
+    // objects never collide with objects that have the same owner
+    game::object const* group_owner = owner->_owner ? owner->_owner.get() : owner;
+
+    body->set_collision_filter({
+        static_cast<uint32_t>(category),
+        static_cast<uint32_t>(mask),
+        group_owner->get_sequence() + 1,
+    });
+
+    _physics.add_body(body);
+    _physics_objects[body] = owner;
+    return *body;
 }
 
 //------------------------------------------------------------------------------
-bool world::physics_filter_callback(physics::rigid_body const* body_a, physics::rigid_body const* body_b)
+void world::remove_body(game::object* owner)
 {
-    game::object* obj_a = _physics_objects[body_a];
-    game::object* obj_b = _physics_objects[body_b];
-
-    if (obj_b->is_type<projectile>()) {
-        return false;
-    }
+    physics::rigid_body* body = owner->_rigid_body;
+    assert(body && "object does not have a rigid body");
 
-    game::object const* owner_a = obj_a->_owner ? obj_a->_owner.get() : obj_a;
-    game::object const* owner_b = obj_b->_owner ? obj_b->_owner.get() : obj_b;
+    _physics.remove_body(body);
+    _physics_objects.erase(body);
 
-    if (owner_a == owner_b) {
-        return false;
-    }
+    // keep the last known pose for any remaining use of the object
+    owner->_position = body->get_position();
+    owner->_rotation = body->get_rotation();
+    owner->_rigid_body = nullptr;
 
-    return true;
+    body->~rigid_body();
+    _bodies.free(body);
 }
 
 //------------------------------------------------------------------------------
@@ -9,16 +9,24 @@
 #include "p_material.h"
 #include "p_rigidbody.h"
 #include "p_shape.h"
+#include "p_shapelibrary.h"
 #include "p_world.h"
 
 #include "net_message.h"
 
 #include "r_particle.h"
 
+#include "cm_enumflag.h"
+#include "cm_pool.h"
+#include "cm_threadpool.h"
+
 #include <array>
+#include <functional>
 #include <memory>
+#include <new>
 #include <queue>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #define MAX_PLAYERS 16
@@ -46,6 +54,33 @@ enum class effect_type
     explosion,
 };
 
+//------------------------------------------------------------------------------
+//! Collision categories of physics bodies, assigned by object type
+enum class collision_layer : uint32_t
+{
+    object = 1 << 0,
+    ship = 1 << 1,
+    shield = 1 << 2,
+    projectile = 1 << 3,
+};
+
+ENUM_FLAG_OPERATORS(collision_layer)
+
+//------------------------------------------------------------------------------
+//! Destroys an object spawned by game::world and returns its storage to the
+//! pool that it was allocated from
+struct object_deleter
+{
+    block_pool* pool;
+
+    void operator()(object* obj) const {
+        obj->~object();
+        pool->free(obj);
+    }
+};
+
+using object_ptr = std::unique_ptr<object, object_deleter>;
+
 //------------------------------------------------------------------------------
 template<typename type> class object_iterator
 {
@@ -76,8 +111,8 @@ protected:
     //! to the appropriate unique_ptr type depending on constness.
     using pointer_type = typename std::conditional<
                              std::is_const<type>::value,
-                             std::unique_ptr<typename std::remove_const<type>::type> const*,
-                             std::unique_ptr<type>*>::type;
+                             object_ptr const*,
+                             object_ptr*>::type;
 
     pointer_type _begin;
     pointer_type _end;
@@ -128,13 +163,112 @@ protected:
     {}
 };
 
+//------------------------------------------------------------------------------
+template<typename type> class typed_object_iterator
+{
+public:
+    //  required for input_iterator
+
+    bool operator!=(typed_object_iterator const& other) const {
+        return _index != other._index;
+    }
+
+    type* operator*() const {
+        return static_cast<type*>(_objects[*_index].get());
+    }
+
+    typed_object_iterator& operator++() {
+        ++_index;
+        return *this;
+    }
+
+    //  required for forward_iterator
+
+    typed_object_iterator operator++(int) const {
+        return ++typed_object_iterator(*this);
+    }
+
+protected:
+    using pointer_type = typename std::conditional<
+                             std::is_const<type>::value,
+                             object_ptr const*,
+                             object_ptr*>::type;
+
+    pointer_type _objects;
+    std::size_t const* _index;
+
+protected:
+    template<typename> friend class typed_object_range;
+
+    typed_object_iterator(pointer_type objects, std::size_t const* index)
+        : _objects(objects)
+        , _index(index)
+    {}
+};
+
+//------------------------------------------------------------------------------
+/*
+    Range of active objects of a single type, including derived types, which
+    only visits objects of that type. Objects are visited in the same order as
+    in the range of all objects, except that objects which were spawned or
+    removed since the start of the current frame may be visited out of order.
+*/
+template<typename type> class typed_object_range
+{
+public:
+    using iterator_type = typed_object_iterator<type>;
+    using pointer_type = typename iterator_type::pointer_type;
+
+    iterator_type begin() const { return iterator_type(_objects, _begin); }
+    iterator_type end() const { return iterator_type(_objects, _end); }
+
+protected:
+    friend world;
+
+    pointer_type _objects;
+    std::size_t const* _begin;
+    std::size_t const* _end;
+
+protected:
+    typed_object_range(pointer_type objects, std::size_t const* begin, std::size_t const* end)
+        : _objects(objects)
+        , _begin(begin)
+        , _end(end)
+    {}
+};
+
+//------------------------------------------------------------------------------
+//! Segment for a batched world trace
+struct trace_query
+{
+    vec2 start;
+    vec2 end;
+    //! Objects in the same collision group as `ignore`, i.e. `ignore` and
+    //! the objects that it owns, are not hit by the segment.
+    game::object const* ignore;
+};
+
+//------------------------------------------------------------------------------
+//! Nearest object hit by a segment in a batched world trace
+struct trace_result
+{
+    game::object* object; //!< null if the segment did not hit any object
+    physics::contact contact;
+};
+
 //------------------------------------------------------------------------------
 class world
 {
 public:
     world ();
+    //! Create a world with the given number of worker threads for object think
+    //! and physics, e.g. zero when many worlds are stepped concurrently.
+    explicit world (std::size_t num_worker_threads);
     ~world ();
 
+    //! Maximum number of worlds than can be referenced by handle
+    constexpr static int max_worlds = 1LLU << handle<object>::system_bits;
+
     void init();
     void shutdown();
 
@@ -145,6 +279,12 @@ public:
 
     void clear_particles();
 
+    //! Worlds which are not drawn, e.g. on a dedicated server, do not create
+    //! particles for effects or play sounds. Effects and sounds are still
+    //! written to snapshots for clients.
+    void set_headless(bool headless) { _headless = headless; }
+    bool headless() const { return _headless; }
+
     void run_frame ();
     void draw(render::system* renderer, time_value time) const;
 
@@ -160,28 +300,116 @@ public:
     //! Return an iterator over all active objects in the world
     object_range<object> objects();
 
+    //! Return an iterator over all active objects of type `T` in the world
+    template<typename T> typed_object_range<T const> objects() const;
+
+    //! Return an iterator over all active objects of type `T` in the world
+    template<typename T> typed_object_range<T> objects();
+
     //! Return a handle to the object with the given sequence id
     template<typename T> handle<T> find(uint64_t sequence) const;
 
-    random& get_random() { return _random; }
+    random_generator& get_random() { return _random; }
 
     void remove(handle<object> object);
 
+    //! Call `fn` after all objects have finished thinking if called during
+    //! `object::think`, otherwise call `fn` immediately. Deferred functions
+    //! are called in the order of the think groups of the objects that
+    //! deferred them, see `object::think_group`, independent of the number of
+    //! threads. `remove`, `add_sound` and the `add_effect` methods defer
+    //! themselves automatically.
+    void defer(std::function<void()>&& fn);
+
+    //! Load sounds which are referenced by index in snapshots, see `add_sound`
+    static void load_sounds();
+
     void add_sound(sound::asset sound_asset, vec2 position, float volume = 1.0f);
     void add_effect(time_value time, effect_type type, vec2 position, vec2 direction = vec2(0,0), float strength = 1);
     void add_trail_effect(effect_type type, vec2 position, vec2 old_position, vec2 direction = vec2(0,0), float strength = 1);
 
-    void add_body(game::object* owner, physics::rigid_body* body);
-    void remove_body(physics::rigid_body* body);
+    //! Immutable shapes shared by objects in all worlds
+    static physics::shape_library& shapes() { return _shapes; }
+
+    //! Allocate a rigid body for `owner` and add it to the physics world,
+    //! the body starts at the position and rotation of `owner`
+    physics::rigid_body& add_body(game::object* owner, physics::shape const* shape, physics::material const* material, float mass);
+    //! Remove the rigid body of `owner` from the physics world and free it
+    void remove_body(game::object* owner);
 
     game::object* trace(physics::contact& contact, vec2 start, vec2 end, game::object const* ignore = nullptr) const;
 
+    //! Trace a batch of segments which are cast in packets that share a
+    //! single broadphase traversal, results are written to `results`.
+    void trace(trace_query const* queries, std::size_t num_queries, trace_result* results) const;
+
+    //! Same as `defer` for a trace. If called during `object::think` then
+    //! `query` is called after all objects have finished thinking, segments
+    //! from all objects are traced in one batch, and `fn(query, result)` is
+    //! called in order with the other deferred functions. Objects spawned by
+    //! deferred functions are not hit. Otherwise traces immediately.
+    void defer_trace(std::function<trace_query()>&& query, std::function<void(trace_query const&, trace_result const&)>&& fn);
+
+    //! Call `fn(object)` for each object of type `T` which has a physics body
+    //! whose bounds intersect `b`, stops early if `fn` returns false.
+    template<typename T = object, typename Fn> void query_box(bounds const& b, Fn&& fn) const;
+
+    //! Call `fn(object)` for each object of type `T` which has a physics body
+    //! whose bounds intersect the circle with the given `center` and `radius`,
+    //! stops early if `fn` returns false.
+    template<typename T = object, typename Fn> void query_radius(vec2 center, float radius, Fn&& fn) const;
+
+    //! Call `fn(object)` for each object of type `T` found by `query_radius`
+    //! around `apex` with radius `range` whose position is within `half_angle`
+    //! radians of `direction`, which must be normalized.
+    template<typename T = object, typename Fn> void query_cone(vec2 apex, vec2 direction, float half_angle, float range, Fn&& fn) const;
+
+    //! Return the object of type `T` found by `query_radius` whose position is
+    //! nearest to `position` and for which `filter(object)` returns true. Ties
+    //! are broken by sequence id so that results do not depend on traversal.
+    template<typename T = object, typename Fn> handle<T> nearest(vec2 position, float max_distance, Fn&& filter) const;
+    template<typename T = object> handle<T> nearest(vec2 position, float max_distance) const;
+
     int framenum() const { return _framenum; }
     time_value frametime() const { return time_value(_framenum * FRAMETIME); }
 
 private:
+    //! Storage for objects of each type by type index, must outlive `_objects`
+    std::array<std::unique_ptr<block_pool>, object_type::_max_types> _pools;
+    //! Storage for the rigid bodies of physical objects, must outlive `_objects`
+    block_pool _bodies;
+
     //! Sparse array of objects in the world, resized as needed
-    std::vector<std::unique_ptr<object>> _objects;
+    std::vector<object_ptr> _objects;
+
+    //! Per-slot state parallel to `_objects`
+    struct slot
+    {
+        //! Sequence id of the object in this slot or zero if the slot is free,
+        //! acts as the slot's generation so that handles to previous objects
+        //! in the slot can be rejected without touching the object itself
+        uint64_t sequence;
+        //! Index of the next slot in the free list if this slot is free
+        std::size_t next_free;
+    };
+    std::vector<slot> _slots;
+
+    //! Head of the intrusive list of free slots
+    std::size_t _free_slot;
+    //! Sentinel value for the end of the free list
+    constexpr static std::size_t no_slot = SIZE_MAX;
+
+    //! Slot index of each object by sequence id
+    std::unordered_map<uint64_t, std::size_t> _sequence_slots;
+
+    //! Slot indices of the objects of each type by type index, including
+    //! objects of derived types. Lists are updated by appending and swap-
+    //! removal and sorted once per frame, see `sort_type_slots`.
+    std::array<std::vector<std::size_t>, object_type::_max_types> _type_slots;
+    //! Position of each slot in the slot list of each type by type index
+    std::array<std::vector<std::size_t>, object_type::_max_types> _type_positions;
+    //! Slot lists which have been modified since they were last sorted
+    std::array<bool, object_type::_max_types> _type_slots_dirty;
 
     //! Objects pending removal
     std::queue<handle<object>> _removed;
@@ -193,14 +421,15 @@ private:
     uint64_t _sequence;
 
     //! Random number generator
-    random _random;
+    random_generator _random;
+
+    //! Do not create particles or play sounds, see `set_headless`
+    bool _headless;
 
     template<typename T> friend class handle;
 
     //! Maximum number of objects that can be referenced by handle
-    constexpr static int max_objects = 1LLU << handle<object>::index_bits;
-    //! Maximum number of worlds than can be referenced by handle
-    constexpr static int max_worlds = 1LLU << handle<object>::system_bits;
+    constexpr static std::size_t max_objects = 1LLU << handle<object>::index_bits;
 
     //! Static array of worlds so that handles can store an index instead of pointer
     static std::array<world*, max_worlds> _singletons;
@@ -208,10 +437,62 @@ private:
     //! Retrieve an object from its handle
     template<typename T> T* get(handle<T> handle) const;
 
+    //! Take a slot from the free list or append a new slot
+    std::size_t allocate_slot();
+    //! Destroy the object in a slot and return the slot to the free list
+    void free_slot(std::size_t index);
+    //! Destroy objects pending removal
+    void flush_removed();
+
+    //! Return the pool for objects of the given type, `size` is the size of
+    //! the type which is used to create the pool on first use
+    block_pool& object_pool(object_type const& type, std::size_t size);
+
+    //! Add the object in a slot to the slot lists of its type and base types
+    void insert_type_slots(std::size_t index);
+    //! Remove the object in a slot from the slot lists of its type and base types
+    void remove_type_slots(std::size_t index);
+    //! Sort slot lists which have been modified into world order
+    void sort_type_slots();
+
+    static physics::shape_library _shapes;
+
+    //! Worker threads for object think and physics, must outlive `_physics`
+    thread_pool _thread_pool;
+
+    //! Objects which think during the current frame and the functions that
+    //! they deferred, see `object::think_group`
+    struct think_group
+    {
+        std::vector<object*> objects;
+        std::vector<std::function<void()>> commands;
+        //! Segments deferred with `defer_trace`
+        std::vector<std::function<trace_query()>> traces;
+        //! Index of the first result for `traces` in `_trace_results`
+        std::size_t first_trace;
+    };
+    std::vector<think_group> _think_groups;
+    //! Index into `_think_groups` by slot index of each group's object
+    std::vector<std::size_t> _think_group_index;
+
+    //! Segments deferred by all think groups during the current frame and
+    //! their results, in group order
+    std::vector<trace_query> _trace_queries;
+    std::vector<trace_result> _trace_results;
+
+    //! Think group running on the current thread, null outside of think
+    static thread_local think_group* _deferred_group;
+
+    //! Call `think` on all objects which were not spawned during this frame
+    void think_objects();
+
     physics::world _physics;
     std::map<physics::rigid_body const*, game::object*> _physics_objects;
 
-    bool physics_filter_callback(physics::rigid_body const* body_a, physics::rigid_body const* body_b);
+    //! Return a filter for spatial queries which only passes the collision
+    //! categories of bodies that can belong to objects of the given type
+    physics::collision_filter query_filter(object_type const& type) const;
+
     bool physics_collide_callback(physics::rigid_body const* body_a, physics::rigid_body const* body_b, physics::collision const& collision);
 
     //
@@ -253,29 +534,110 @@ T* world::spawn(Args&& ...args)
     static_assert(std::is_base_of<game::object, T>::value,
                   "'spawn': 'T' must be derived from 'game::object'");
 
-    uint64_t obj_index = 0;
-    // try to find an unused slot in the objects array
-    for (; obj_index < _objects.size(); ++obj_index) {
-        if (!_objects[obj_index]) {
-            break;
-        }
-    }
+    static_assert(alignof(T) <= block_pool::block_alignment,
+                  "'spawn': 'T' is over-aligned");
+    assert(!_deferred_group && "objects must be spawned with 'defer' during think");
 
-    if (obj_index == _objects.size()) {
-        assert(_objects.size() < max_objects);
-        _objects.push_back(std::make_unique<T>(std::move(args)...));
-    } else {
-        _objects[obj_index] = std::make_unique<T>(std::move(args)...);
-    }
+    std::size_t obj_index = allocate_slot();
+    block_pool& pool = object_pool(T::_type, sizeof(T));
+    void* block = pool.allocate();
+    _objects[obj_index] = object_ptr(new (block) T(std::move(args)...), object_deleter{&pool});
 
     T* obj = static_cast<T*>(_objects[obj_index].get());
-    assert(obj->is_type<T>() && "invalid type info");
+    assert(obj->template is_type<T>() && "invalid type info");
+    // the deleter frees the object's address, which must be the block address
+    assert(static_cast<void*>(_objects[obj_index].get()) == block && "invalid object layout");
     obj->_self = handle<object>(obj_index, _index, ++_sequence);
+    _slots[obj_index].sequence = _sequence;
+    _sequence_slots[_sequence] = obj_index;
+    insert_type_slots(obj_index);
     obj->_spawn_time = frametime();
     obj->spawn();
     return obj;
 }
 
+//------------------------------------------------------------------------------
+template<typename T> typed_object_range<T const> world::objects() const
+{
+    static_assert(std::is_base_of<game::object, T>::value,
+                  "'objects': 'T' must be derived from 'game::object'");
+
+    auto const& slots = _type_slots[T::_type._type_index];
+    return typed_object_range<T const>(
+        _objects.data(),
+        slots.data(),
+        slots.data() + slots.size()
+    );
+}
+
+//------------------------------------------------------------------------------
+template<typename T> typed_object_range<T> world::objects()
+{
+    static_assert(std::is_base_of<game::object, T>::value,
+                  "'objects': 'T' must be derived from 'game::object'");
+
+    auto const& slots = _type_slots[T::_type._type_index];
+    return typed_object_range<T>(
+        _objects.data(),
+        slots.data(),
+        slots.data() + slots.size()
+    );
+}
+
+//------------------------------------------------------------------------------
+template<typename T, typename Fn> void world::query_box(bounds const& b, Fn&& fn) const
+{
+    _physics.query(b, query_filter(T::_type), [this, &fn](physics::rigid_body const* body) {
+        game::object* obj = _physics_objects.at(body);
+        return !obj->is_type<T>() || fn(static_cast<T*>(obj));
+    });
+}
+
+//------------------------------------------------------------------------------
+template<typename T, typename Fn> void world::query_radius(vec2 center, float radius, Fn&& fn) const
+{
+    _physics.query(center, radius, query_filter(T::_type), [this, &fn](physics::rigid_body const* body) {
+        game::object* obj = _physics_objects.at(body);
+        return !obj->is_type<T>() || fn(static_cast<T*>(obj));
+    });
+}
+
+//------------------------------------------------------------------------------
+template<typename T, typename Fn> void world::query_cone(vec2 apex, vec2 direction, float half_angle, float range, Fn&& fn) const
+{
+    float cos_half_angle = std::cos(half_angle);
+    query_radius<T>(apex, range, [apex, direction, cos_half_angle, &fn](T* obj) {
+        vec2 displacement = obj->get_position() - apex;
+        return displacement.dot(direction) < displacement.length() * cos_half_angle || fn(obj);
+    });
+}
+
+//------------------------------------------------------------------------------
+template<typename T, typename Fn> handle<T> world::nearest(vec2 position, float max_distance, Fn&& filter) const
+{
+    T* best = nullptr;
+    float best_distance_sqr = square(max_distance);
+    query_radius<T>(position, max_distance, [position, &filter, &best, &best_distance_sqr](T* obj) {
+        float distance_sqr = (obj->get_position() - position).length_sqr();
+        if (distance_sqr > best_distance_sqr) {
+            return true;
+        } else if (best && distance_sqr == best_distance_sqr && obj->get_sequence() > best->get_sequence()) {
+            return true;
+        } else if (filter(static_cast<T const*>(obj))) {
+            best = obj;
+            best_distance_sqr = distance_sqr;
+        }
+        return true;
+    });
+    return handle<T>(best);
+}
+
+//------------------------------------------------------------------------------
+template<typename T> handle<T> world::nearest(vec2 position, float max_distance) const
+{
+    return nearest<T>(position, max_distance, [](T const*) { return true; });
+}
+
 //------------------------------------------------------------------------------
 template<typename T> handle<T> world::find(uint64_t sequence) const
 {
@@ -283,10 +645,9 @@ template<typename T> handle<T> world::find(uint64_t sequence) const
         return handle<T>(0, _index, 0);
     }
 
-    for (auto& obj : _objects) {
-        if (obj.get() && sequence == obj->_self.get_sequence()) {
-            return obj->_self;
-        }
+    auto it = _sequence_slots.find(sequence);
+    if (it != _sequence_slots.end()) {
+        return handle<T>(it->second, _index, sequence);
     }
 
     return handle<T>(0, _index, 0);
@@ -297,12 +658,33 @@ template<typename T> T* world::get(handle<T> h) const
 {
     assert(h.get_world_index() == _index);
     assert(h.get_index() < max_objects);
-    if (h.get_index() < _objects.size()
-            && _objects[h.get_index()]
-            && h.get_sequence() == _objects[h.get_index()]->_self.get_sequence()) {
+    // free slots have a sequence of zero which is never assigned to an object
+    if (h.get_index() < _slots.size()
+            && h.get_sequence()
+            && h.get_sequence() == _slots[h.get_index()].sequence) {
         return static_cast<T*>(_objects[h.get_index()].get());
     }
     return nullptr;
 }
 
+//------------------------------------------------------------------------------
+template<typename T> T const* handle<T>::get() const
+{
+    game::world* world = get_world();
+    return world ? world->get<T>(*this) : nullptr;
+}
+
+//------------------------------------------------------------------------------
+template<typename T> T* handle<T>::get()
+{
+    game::world* world = get_world();
+    return world ? world->get<T>(*this) : nullptr;
+}
+
+//------------------------------------------------------------------------------
+template<typename T> game::world* handle<T>::get_world() const
+{
+    return world::_singletons[get_world_index()];
+}
+
 } // namespace game
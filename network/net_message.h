@@ -121,15 +121,20 @@ protected:
 };
 
 //------------------------------------------------------------------------------
-class message_storage : public message
+//! Buffer for message_storage, which is a base class so that the buffer is
+//! constructed before the message which refers to it
+struct message_buffer
+{
+    std::array<byte, 1400> _buffer;
+};
+
+//------------------------------------------------------------------------------
+class message_storage : protected message_buffer, public message
 {
 public:
     message_storage()
         : message(_buffer.data(), _buffer.size())
     {}
-
-protected:
-    std::array<byte, 1400> _buffer;
 };
 
 } // namespace network
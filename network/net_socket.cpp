@@ -5,7 +5,54 @@
 #include "net_address.h"
 #include "net_message.h"
 
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+#if defined(_WIN32)
 #include <WS2tcpip.h>
+#else // !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define INVALID_SOCKET  (~std::uintptr_t(0))
+#define SOCKET_ERROR    (-1)
+#endif // !defined(_WIN32)
+
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+//! Link-local all-nodes multicast address, ff02::1
+constexpr in6_addr link_local_all_nodes = {{{0xff, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x01}}};
+
+//------------------------------------------------------------------------------
+int close_socket(std::uintptr_t s)
+{
+#if defined(_WIN32)
+    return ::closesocket(s);
+#else
+    return ::close(static_cast<int>(s));
+#endif
+}
+
+//------------------------------------------------------------------------------
+int set_nonblocking(std::uintptr_t s)
+{
+#if defined(_WIN32)
+    u_long args = 1;
+    return ::ioctlsocket(s, FIONBIO, &args);
+#else
+    int args = 1;
+    return ::ioctl(static_cast<int>(s), FIONBIO, &args);
+#endif
+}
+
+} // anonymous namespace
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace network {
@@ -14,7 +61,7 @@ namespace network {
 socket::socket()
     : _type(socket_type::unspecified)
     , _port(any)
-    , _socket(0)
+    , _socket(invalid_socket)
 {}
 
 //------------------------------------------------------------------------------
@@ -36,7 +83,7 @@ socket::socket(socket&& other)
     , _port(other._port)
     , _socket(other._socket)
 {
-    other._socket = 0;
+    other._socket = invalid_socket;
 }
 
 //------------------------------------------------------------------------------
@@ -48,7 +95,7 @@ socket& socket::operator=(socket&& other)
     _port = other._port;
     _socket = other._socket;
 
-    other._socket = 0;
+    other._socket = invalid_socket;
     return *this;
 }
 
@@ -61,46 +108,46 @@ bool socket::open(socket_type type, word port)
     _port = static_cast<socket_port>(port);
     _socket = open_socket(type, port);
 
-    return _socket != 0;
+    return _socket != invalid_socket;
 }
 
 //------------------------------------------------------------------------------
 std::uintptr_t socket::open_socket(socket_type type, word port) const
 {
-    std::uintptr_t newsocket = 0;
-    unsigned long args = 1;
+    std::uintptr_t newsocket = invalid_socket;
+    int args = 1;
 
     int family = (type == socket_type::ipv4) ? PF_INET :
                  (type == socket_type::ipv6) ? PF_INET6 : PF_UNSPEC;
 
     // get socket
-    if ( (newsocket = ::socket(family, SOCK_DGRAM, IPPROTO_UDP)) == INVALID_SOCKET) {
-        return 0;
+    if ( (newsocket = static_cast<std::uintptr_t>(::socket(family, SOCK_DGRAM, IPPROTO_UDP))) == INVALID_SOCKET) {
+        return invalid_socket;
     }
 
     // disable blocking
-    if (ioctlsocket(newsocket, FIONBIO, &args) == SOCKET_ERROR) {
-        ::closesocket(newsocket);
-        return 0;
+    if (set_nonblocking(newsocket) == SOCKET_ERROR) {
+        close_socket(newsocket);
+        return invalid_socket;
     }
 
     // enable broadcasting
     if (type == socket_type::ipv4) {
         if (setsockopt(newsocket, SOL_SOCKET, SO_BROADCAST, (char const*)&args, sizeof(args) ) == SOCKET_ERROR) {
-            ::closesocket(newsocket);
-            return 0;
+            close_socket(newsocket);
+            return invalid_socket;
         }
 
     } else if (type == socket_type::ipv6) {
         ipv6_mreq mreq = {};
 
-        mreq.ipv6mr_multiaddr = in6addr_allnodesonlink;
+        mreq.ipv6mr_multiaddr = link_local_all_nodes;
         mreq.ipv6mr_interface = 0;
 
         //  add membership to link-local multicast group
         if (setsockopt(newsocket, IPPROTO_IPV6, IPV6_ADD_MEMBERSHIP, (char const*)&mreq, sizeof(mreq)) == SOCKET_ERROR) {
-            ::closesocket(newsocket);
-            return 0;
+            close_socket(newsocket);
+            return invalid_socket;
         }
     }
 
@@ -109,7 +156,7 @@ std::uintptr_t socket::open_socket(socket_type type, word port) const
         sockaddr_in address = {};
 
         address.sin_port = htons(port);
-        address.sin_addr = in4addr_any;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
         address.sin_family = AF_INET;
 
         if (bind(newsocket, (sockaddr *)&address, sizeof(address)) != SOCKET_ERROR) {
@@ -128,17 +175,43 @@ std::uintptr_t socket::open_socket(socket_type type, word port) const
         }
     }
 
-    closesocket(newsocket);
-    return false;
+    close_socket(newsocket);
+    return invalid_socket;
 }
 
 //------------------------------------------------------------------------------
 void socket::close()
 {
-    if (_socket) {
-        ::closesocket(_socket);
-        _socket = 0;
+    if (_socket != invalid_socket) {
+        close_socket(_socket);
+        _socket = invalid_socket;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool socket::wait(time_delta timeout) const
+{
+    if (_socket == invalid_socket) {
+        return false;
     }
+
+    fd_set readfds;
+    FD_ZERO(&readfds);
+#if defined(_WIN32)
+    FD_SET(_socket, &readfds);
+#else
+    FD_SET(static_cast<int>(_socket), &readfds);
+#endif
+
+    int64_t microseconds = std::max<int64_t>(timeout.to_microseconds(), 0);
+    timeval tv;
+    tv.tv_sec = static_cast<long>(microseconds / 1000000);
+    tv.tv_usec = static_cast<long>(microseconds % 1000000);
+
+    // first argument is ignored by winsock, returns early if interrupted
+    int result = ::select(static_cast<int>(_socket + 1), &readfds, nullptr, nullptr, &tv);
+
+    return result > 0;
 }
 
 //------------------------------------------------------------------------------
@@ -147,7 +220,7 @@ bool socket::read(network::address& remote, network::message& message)
     sockaddr_storage from = {};
     socklen_t fromlen = sizeof(from);
 
-    if (!_socket) {
+    if (_socket == invalid_socket) {
         return false;
     }
 
@@ -172,9 +245,9 @@ bool socket::read(network::address& remote, network::message& message)
 bool socket::write(network::address const& remote, network::message const& message)
 {
     sockaddr_storage to = {};
-    int tolen = sizeof(to);
+    socklen_t tolen = sizeof(to);
 
-    if (!_socket) {
+    if (_socket == invalid_socket) {
         return false;
     }
 
@@ -187,7 +260,7 @@ bool socket::write(network::address const& remote, network::message const& messa
 
     int result = ::sendto(_socket, buf, narrow_cast<int>(len), 0, (sockaddr*)&to, tolen);
 
-    if (result < len) {
+    if (result < 0 || static_cast<std::size_t>(result) < len) {
         return false;
     }
 
@@ -205,10 +278,10 @@ bool socket::printf(network::address const& remote, string::literal fmt, ...)
     byte* buf = message.reserve(size);
 
     va_start(va, fmt);
-    int len = vsprintf_s((char*)buf, size, fmt.c_str(), va);
+    int len = vsnprintf((char*)buf, size, fmt.c_str(), va);
     va_end(va);
 
-    if (len >= 0) {
+    if (len >= 0 && static_cast<std::size_t>(len) < size) {
         message.commit(len + 1);
         return write(remote, message);
     } else {
@@ -250,8 +323,9 @@ bool socket::sockaddr_to_address(sockaddr_storage const& sockaddr, network::addr
             address.port = ntohs(sockaddr_ipv4.sin_port);
             address.ip6.fill(0);
             address.ip6[5] = 0xffff;
-            address.ip6[6] = ntohs(sockaddr_ipv4.sin_addr.S_un.S_un_w.s_w1);
-            address.ip6[7] = ntohs(sockaddr_ipv4.sin_addr.S_un.S_un_w.s_w2);
+            auto const* bytes = reinterpret_cast<byte const*>(&sockaddr_ipv4.sin_addr);
+            address.ip6[6] = narrow_cast<word>((bytes[0] << 8) | bytes[1]);
+            address.ip6[7] = narrow_cast<word>((bytes[2] << 8) | bytes[3]);
         } else {
             return false;
         }
@@ -261,8 +335,9 @@ bool socket::sockaddr_to_address(sockaddr_storage const& sockaddr, network::addr
         if (_type == socket_type::ipv6 || _type == socket_type::unspecified) {
             address.type = network::address_type::ipv6;
             address.port = ntohs(sockaddr_ipv6.sin6_port);
+            auto const* bytes = reinterpret_cast<byte const*>(&sockaddr_ipv6.sin6_addr);
             for (std::size_t ii = 0; ii < address.ip6.size(); ++ii) {
-                address.ip6[ii] = ntohs(sockaddr_ipv6.sin6_addr.u.Word[ii]);
+                address.ip6[ii] = narrow_cast<word>((bytes[ii * 2] << 8) | bytes[ii * 2 + 1]);
             }
         } else {
             return false;
@@ -284,9 +359,9 @@ bool socket::address_to_sockaddr(network::address const& address, sockaddr_stora
         sockaddr_ipv4.sin_port = htons(address.port);
 
         if (address.type == network::address_type::loopback) {
-            sockaddr_ipv4.sin_addr = in4addr_loopback;
+            sockaddr_ipv4.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
         } else if (address.type == network::address_type::broadcast) {
-            sockaddr_ipv4.sin_addr = in4addr_broadcast;
+            sockaddr_ipv4.sin_addr.s_addr = htonl(INADDR_BROADCAST);
         } else if (address.type == network::address_type::ipv4) {
             sockaddr_ipv4.sin_addr.s_addr = *(uint32_t*)address.ip4.data();
         } else {
@@ -301,17 +376,21 @@ bool socket::address_to_sockaddr(network::address const& address, sockaddr_stora
         if (address.type == network::address_type::loopback) {
             sockaddr_ipv6.sin6_addr = in6addr_loopback;
         } else if (address.type == network::address_type::broadcast) {
-            sockaddr_ipv6.sin6_addr = in6addr_allnodesonlink;
+            sockaddr_ipv6.sin6_addr = link_local_all_nodes;
         } else if (address.type == network::address_type::ipv4) {
             // IPv4-mapped IPv6 address
-            sockaddr_ipv6.sin6_addr.u.Word[ 5] = 0xffff;
-            sockaddr_ipv6.sin6_addr.u.Byte[12] = address.ip4[0];
-            sockaddr_ipv6.sin6_addr.u.Byte[13] = address.ip4[1];
-            sockaddr_ipv6.sin6_addr.u.Byte[14] = address.ip4[2];
-            sockaddr_ipv6.sin6_addr.u.Byte[15] = address.ip4[3];
+            auto* bytes = reinterpret_cast<byte*>(&sockaddr_ipv6.sin6_addr);
+            bytes[10] = 0xff;
+            bytes[11] = 0xff;
+            bytes[12] = address.ip4[0];
+            bytes[13] = address.ip4[1];
+            bytes[14] = address.ip4[2];
+            bytes[15] = address.ip4[3];
         } else if (address.type == network::address_type::ipv6) {
-            for (size_t ii = 0; ii < address.ip6.size(); ++ii) {
-                sockaddr_ipv6.sin6_addr.u.Word[ii] = htons(address.ip6[ii]);
+            auto* bytes = reinterpret_cast<byte*>(&sockaddr_ipv6.sin6_addr);
+            for (std::size_t ii = 0; ii < address.ip6.size(); ++ii) {
+                bytes[ii * 2 + 0] = narrow_cast<byte>(address.ip6[ii] >> 8);
+                bytes[ii * 2 + 1] = narrow_cast<byte>(address.ip6[ii] & 0xff);
             }
         } else {
             return false;
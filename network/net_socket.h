@@ -5,6 +5,7 @@
 
 #include "cm_shared.h"
 #include "cm_string.h"
+#include "cm_time.h"
 
 struct sockaddr_storage;
 
@@ -32,10 +33,13 @@ public:
     socket_type type() const { return _type; }
     socket_port port() const { return _port; }
 
-    bool valid() const { return _socket != 0; }
+    bool valid() const { return _socket != invalid_socket; }
     bool open(socket_type type, word port = socket_port::any);
     void close();
 
+    //! block until data can be read or the timeout expires, returns true
+    //! if data can be read
+    bool wait(time_delta timeout) const;
     //! read data info message and set remote address
     bool read(network::address& remote, network::message& message);
     //! write data to the remote address
@@ -51,6 +55,14 @@ protected:
     socket_port _port;
     std::uintptr_t _socket;
 
+    //! value of `_socket` when no socket is open, zero is a valid descriptor
+    //! on POSIX platforms
+#if defined(_WIN32)
+    static constexpr std::uintptr_t invalid_socket = 0;
+#else // !defined(_WIN32)
+    static constexpr std::uintptr_t invalid_socket = ~std::uintptr_t(0);
+#endif // !defined(_WIN32)
+
 protected:
     socket(socket const&) = delete;
     socket& operator=(socket const&) = delete;
@@ -0,0 +1,257 @@
+// p_aabbtree.cpp
+//
+
+#include "p_aabbtree.h"
+
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace physics {
+
+//------------------------------------------------------------------------------
+aabb_tree::aabb_tree()
+    : _root(null_proxy)
+    , _free_list(null_proxy)
+{}
+
+//------------------------------------------------------------------------------
+aabb_tree::proxy aabb_tree::insert(rigid_body* body, bounds const& b)
+{
+    proxy id = allocate_node();
+    _nodes[id].aabb = b.expand(margin);
+    _nodes[id].body = body;
+    _nodes[id].height = 0;
+
+    insert_leaf(id);
+    return id;
+}
+
+//------------------------------------------------------------------------------
+void aabb_tree::remove(proxy id)
+{
+    assert(_nodes[id].is_leaf());
+    remove_leaf(id);
+    free_node(id);
+}
+
+//------------------------------------------------------------------------------
+bool aabb_tree::update(proxy id, bounds const& b, vec2 displacement)
+{
+    assert(_nodes[id].is_leaf());
+    if (_nodes[id].aabb.contains(b)) {
+        return false;
+    }
+
+    remove_leaf(id);
+
+    // extend the fat bounds in the direction of movement
+    bounds aabb = b.expand(margin);
+    displacement *= 2.f;
+    for (int axis = 0; axis < 2; ++axis) {
+        if (displacement[axis] < 0.f) {
+            aabb[0][axis] += displacement[axis];
+        } else {
+            aabb[1][axis] += displacement[axis];
+        }
+    }
+
+    _nodes[id].aabb = aabb;
+    insert_leaf(id);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+aabb_tree::proxy aabb_tree::allocate_node()
+{
+    proxy id;
+    if (_free_list != null_proxy) {
+        id = _free_list;
+        _free_list = _nodes[id].parent;
+    } else {
+        id = _nodes.size();
+        _nodes.push_back({});
+    }
+
+    _nodes[id].body = nullptr;
+    _nodes[id].parent = null_proxy;
+    _nodes[id].children[0] = null_proxy;
+    _nodes[id].children[1] = null_proxy;
+    _nodes[id].height = 0;
+    return id;
+}
+
+//------------------------------------------------------------------------------
+void aabb_tree::free_node(proxy id)
+{
+    _nodes[id].parent = _free_list;
+    _nodes[id].height = -1;
+    _free_list = id;
+}
+
+//------------------------------------------------------------------------------
+void aabb_tree::insert_leaf(proxy leaf)
+{
+    if (_root == null_proxy) {
+        _root = leaf;
+        _nodes[leaf].parent = null_proxy;
+        return;
+    }
+
+    // find the best sibling for the new leaf using the surface area heuristic
+    bounds leaf_bounds = _nodes[leaf].aabb;
+    proxy index = _root;
+    while (!_nodes[index].is_leaf()) {
+        proxy child0 = _nodes[index].children[0];
+        proxy child1 = _nodes[index].children[1];
+
+        float area = perimeter(_nodes[index].aabb);
+        float combined_area = perimeter(_nodes[index].aabb | leaf_bounds);
+
+        // cost of creating a new parent for this node and the new leaf
+        float cost = 2.f * combined_area;
+        // minimum cost of pushing the leaf further down the tree
+        float inheritance_cost = 2.f * (combined_area - area);
+
+        float costs[2];
+        for (int ii = 0; ii < 2; ++ii) {
+            node const& child = _nodes[_nodes[index].children[ii]];
+            if (child.is_leaf()) {
+                costs[ii] = perimeter(leaf_bounds | child.aabb) + inheritance_cost;
+            } else {
+                costs[ii] = perimeter(leaf_bounds | child.aabb) - perimeter(child.aabb) + inheritance_cost;
+            }
+        }
+
+        if (cost < costs[0] && cost < costs[1]) {
+            break;
+        }
+
+        index = costs[0] < costs[1] ? child0 : child1;
+    }
+
+    // create a new parent for the sibling and the new leaf
+    proxy sibling = index;
+    proxy old_parent = _nodes[sibling].parent;
+    proxy new_parent = allocate_node();
+    _nodes[new_parent].parent = old_parent;
+    _nodes[new_parent].aabb = leaf_bounds | _nodes[sibling].aabb;
+    _nodes[new_parent].height = _nodes[sibling].height + 1;
+    _nodes[new_parent].children[0] = sibling;
+    _nodes[new_parent].children[1] = leaf;
+    _nodes[sibling].parent = new_parent;
+    _nodes[leaf].parent = new_parent;
+
+    if (old_parent != null_proxy) {
+        int slot = _nodes[old_parent].children[0] == sibling ? 0 : 1;
+        _nodes[old_parent].children[slot] = new_parent;
+    } else {
+        _root = new_parent;
+    }
+
+    // walk back up the tree fixing heights and bounds
+    for (index = _nodes[leaf].parent; index != null_proxy; index = _nodes[index].parent) {
+        index = balance(index);
+
+        proxy child0 = _nodes[index].children[0];
+        proxy child1 = _nodes[index].children[1];
+
+        _nodes[index].height = 1 + std::max(_nodes[child0].height, _nodes[child1].height);
+        _nodes[index].aabb = _nodes[child0].aabb | _nodes[child1].aabb;
+    }
+}
+
+//------------------------------------------------------------------------------
+void aabb_tree::remove_leaf(proxy leaf)
+{
+    if (leaf == _root) {
+        _root = null_proxy;
+        return;
+    }
+
+    proxy parent = _nodes[leaf].parent;
+    proxy grandparent = _nodes[parent].parent;
+    proxy sibling = _nodes[parent].children[0] == leaf
+                  ? _nodes[parent].children[1]
+                  : _nodes[parent].children[0];
+
+    if (grandparent == null_proxy) {
+        _root = sibling;
+        _nodes[sibling].parent = null_proxy;
+        free_node(parent);
+        return;
+    }
+
+    // replace the parent with the sibling and free the parent
+    int slot = _nodes[grandparent].children[0] == parent ? 0 : 1;
+    _nodes[grandparent].children[slot] = sibling;
+    _nodes[sibling].parent = grandparent;
+    free_node(parent);
+
+    // walk back up the tree fixing heights and bounds
+    for (proxy index = grandparent; index != null_proxy; index = _nodes[index].parent) {
+        index = balance(index);
+
+        proxy child0 = _nodes[index].children[0];
+        proxy child1 = _nodes[index].children[1];
+
+        _nodes[index].height = 1 + std::max(_nodes[child0].height, _nodes[child1].height);
+        _nodes[index].aabb = _nodes[child0].aabb | _nodes[child1].aabb;
+    }
+}
+
+//------------------------------------------------------------------------------
+aabb_tree::proxy aabb_tree::balance(proxy a)
+{
+    if (_nodes[a].is_leaf() || _nodes[a].height < 2) {
+        return a;
+    }
+
+    proxy b = _nodes[a].children[0];
+    proxy c = _nodes[a].children[1];
+    int difference = _nodes[c].height - _nodes[b].height;
+
+    if (difference > 1) {
+        // rotate c up
+        std::swap(b, c);
+    } else if (difference >= -1) {
+        return a;
+    }
+
+    // `b` is the taller child of `a` and is rotated up to replace `a`,
+    // `c` is the other child of `a` which remains in place.
+    int b_slot = _nodes[a].children[0] == b ? 0 : 1;
+    proxy f = _nodes[b].children[0];
+    proxy g = _nodes[b].children[1];
+
+    // swap a and b
+    _nodes[b].children[0] = a;
+    _nodes[b].parent = _nodes[a].parent;
+    _nodes[a].parent = b;
+
+    if (_nodes[b].parent != null_proxy) {
+        proxy parent = _nodes[b].parent;
+        int slot = _nodes[parent].children[0] == a ? 0 : 1;
+        _nodes[parent].children[slot] = b;
+    } else {
+        _root = b;
+    }
+
+    // keep the taller grandchild under b and move the shorter one under a
+    if (_nodes[f].height < _nodes[g].height) {
+        std::swap(f, g);
+    }
+
+    _nodes[b].children[1] = f;
+    _nodes[a].children[b_slot] = g;
+    _nodes[g].parent = a;
+
+    _nodes[a].aabb = _nodes[c].aabb | _nodes[g].aabb;
+    _nodes[b].aabb = _nodes[a].aabb | _nodes[f].aabb;
+
+    _nodes[a].height = 1 + std::max(_nodes[c].height, _nodes[g].height);
+    _nodes[b].height = 1 + std::max(_nodes[a].height, _nodes[f].height);
+
+    return b;
+}
+
+} // namespace physics
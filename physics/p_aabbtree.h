@@ -0,0 +1,314 @@
+// p_aabbtree.h
+//
+
+#pragma once
+
+#include "cm_bounds.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace physics {
+
+class rigid_body;
+
+//------------------------------------------------------------------------------
+/*
+    Dynamic bounding volume tree
+
+    Each leaf stores an enlarged ("fat") copy of the bounds of a rigid body so
+    that small movements do not modify the tree. When the bounds of a body move
+    outside of its fat bounds the leaf is removed and reinserted, and the tree
+    is rebalanced with tree rotations on the path back to the root. Queries
+    only descend into nodes whose bounds intersect the query volume.
+*/
+class aabb_tree
+{
+public:
+    using proxy = std::size_t;
+
+    static constexpr proxy null_proxy = SIZE_MAX;
+    //! Distance that leaf bounds are expanded by in all directions
+    static constexpr float margin = 1.f;
+    //! Maximum height of the tree, bounded by the rebalancing heuristic
+    static constexpr std::size_t max_stack = 128;
+
+    aabb_tree();
+
+    //! Insert a new leaf for the given body, returns the proxy id
+    proxy insert(rigid_body* body, bounds const& b);
+
+    //! Remove the leaf with the given proxy id
+    void remove(proxy id);
+
+    //! Update the bounds of a leaf, `displacement` is the expected movement
+    //! of the body which is used to extend the fat bounds. Returns true if
+    //! the leaf had to be reinserted.
+    bool update(proxy id, bounds const& b, vec2 displacement = vec2_zero);
+
+    //! Return the enlarged bounds for the given leaf
+    bounds const& get_bounds(proxy id) const {
+        return _nodes[id].aabb;
+    }
+
+    rigid_body* get_body(proxy id) const {
+        return _nodes[id].body;
+    }
+
+    //! Call `fn(proxy)` for each leaf whose bounds intersect `b`. Traversal
+    //! stops early if `fn` returns false.
+    template<typename Fn> void query(bounds const& b, Fn&& fn) const;
+
+    //! Call `fn(proxy)` for each leaf whose bounds intersect the circle
+    //! with the given `center` and `radius`. Traversal stops early if `fn`
+    //! returns false.
+    template<typename Fn> void query(vec2 center, float radius, Fn&& fn) const;
+
+    //! Call `fn(proxy, max_fraction)` for each leaf whose bounds intersect the
+    //! segment from `start` to `end`, clipped to `max_fraction`. `fn` returns
+    //! the new maximum fraction, i.e. the fraction of the nearest hit found so
+    //! far, so that subsequent leaves beyond the nearest hit are skipped.
+    template<typename Fn> void raycast(vec2 start, vec2 end, Fn&& fn) const;
+
+    //! Maximum number of segments in a packet for `raycast`
+    static constexpr std::size_t max_packet = 4;
+
+    //! Cast a packet of up to `max_packet` segments in a single traversal.
+    //! Each node is tested against every segment in the packet and is only
+    //! skipped if no segment intersects it. `fn(proxy, index, max_fraction)`
+    //! is called for each leaf that intersects segment `index` and returns
+    //! the new maximum fraction for that segment.
+    template<typename Fn> void raycast(std::size_t num_segments, vec2 const* starts, vec2 const* ends, Fn&& fn) const;
+
+protected:
+    struct node
+    {
+        bounds aabb;
+        rigid_body* body;
+        //! Parent node, or next node in the free list
+        proxy parent;
+        proxy children[2];
+        //! Height of the subtree rooted at this node, leaves have height 0
+        //! and free nodes have height -1.
+        int height;
+
+        bool is_leaf() const { return children[0] == null_proxy; }
+    };
+
+    std::vector<node> _nodes;
+    proxy _root;
+    proxy _free_list;
+
+protected:
+    proxy allocate_node();
+    void free_node(proxy id);
+
+    void insert_leaf(proxy leaf);
+    void remove_leaf(proxy leaf);
+
+    //! Perform a tree rotation at `id` if it is unbalanced, returns the
+    //! index of the node that replaces `id` in the tree.
+    proxy balance(proxy id);
+
+    static float perimeter(bounds const& b) {
+        vec2 size = b.size();
+        return 2.f * (size.x + size.y);
+    }
+};
+
+//------------------------------------------------------------------------------
+template<typename Fn> void aabb_tree::query(bounds const& b, Fn&& fn) const
+{
+    proxy stack[max_stack];
+    std::size_t count = 0;
+
+    if (_root != null_proxy) {
+        stack[count++] = _root;
+    }
+
+    while (count) {
+        node const& n = _nodes[stack[--count]];
+        if (!n.aabb.intersects(b)) {
+            continue;
+        }
+
+        if (n.is_leaf()) {
+            if (!fn(&n - _nodes.data())) {
+                return;
+            }
+        } else {
+            assert(count + 2 <= max_stack);
+            stack[count++] = n.children[0];
+            stack[count++] = n.children[1];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename Fn> void aabb_tree::query(vec2 center, float radius, Fn&& fn) const
+{
+    proxy stack[max_stack];
+    std::size_t count = 0;
+
+    if (_root != null_proxy) {
+        stack[count++] = _root;
+    }
+
+    while (count) {
+        node const& n = _nodes[stack[--count]];
+        if (!n.aabb.intersects_circle(center, radius)) {
+            continue;
+        }
+
+        if (n.is_leaf()) {
+            if (!fn(&n - _nodes.data())) {
+                return;
+            }
+        } else {
+            assert(count + 2 <= max_stack);
+            stack[count++] = n.children[0];
+            stack[count++] = n.children[1];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename Fn> void aabb_tree::raycast(vec2 start, vec2 end, Fn&& fn) const
+{
+    vec2 delta = end - start;
+    // reciprocal of the segment direction, infinite for axis-aligned segments
+    vec2 inverse_delta = vec2(1.f / delta.x, 1.f / delta.y);
+    float max_fraction = 1.f;
+
+    proxy stack[max_stack];
+    std::size_t count = 0;
+
+    if (_root != null_proxy) {
+        stack[count++] = _root;
+    }
+
+    while (count) {
+        node const& n = _nodes[stack[--count]];
+
+        // slab test against the node bounds
+        float tmin = 0.f;
+        float tmax = max_fraction;
+        for (int axis = 0; axis < 2; ++axis) {
+            if (delta[axis] == 0.f) {
+                if (start[axis] < n.aabb[0][axis] || start[axis] > n.aabb[1][axis]) {
+                    tmin = tmax + 1.f;
+                }
+                continue;
+            }
+            float t0 = (n.aabb[0][axis] - start[axis]) * inverse_delta[axis];
+            float t1 = (n.aabb[1][axis] - start[axis]) * inverse_delta[axis];
+            tmin = std::max(tmin, std::min(t0, t1));
+            tmax = std::min(tmax, std::max(t0, t1));
+        }
+        if (tmin > tmax) {
+            continue;
+        }
+
+        if (n.is_leaf()) {
+            max_fraction = fn(&n - _nodes.data(), max_fraction);
+            if (max_fraction <= 0.f) {
+                return;
+            }
+        } else {
+            assert(count + 2 <= max_stack);
+            stack[count++] = n.children[0];
+            stack[count++] = n.children[1];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+template<typename Fn> void aabb_tree::raycast(std::size_t num_segments, vec2 const* starts, vec2 const* ends, Fn&& fn) const
+{
+    assert(num_segments <= max_packet);
+
+    // segments are stored as structure-of-arrays so that each node is tested
+    // against all segments in the packet with the same instructions, unused
+    // segments have a negative maximum fraction and never intersect a node.
+    float start_x[max_packet];
+    float start_y[max_packet];
+    float inverse_delta_x[max_packet];
+    float inverse_delta_y[max_packet];
+    float max_fraction[max_packet];
+
+    for (std::size_t ii = 0; ii < max_packet; ++ii) {
+        if (ii < num_segments) {
+            start_x[ii] = starts[ii].x;
+            start_y[ii] = starts[ii].y;
+            inverse_delta_x[ii] = 1.f / (ends[ii].x - starts[ii].x);
+            inverse_delta_y[ii] = 1.f / (ends[ii].y - starts[ii].y);
+            max_fraction[ii] = 1.f;
+        } else {
+            start_x[ii] = start_y[ii] = 0.f;
+            inverse_delta_x[ii] = inverse_delta_y[ii] = 1.f;
+            max_fraction[ii] = -1.f;
+        }
+    }
+
+    proxy stack[max_stack];
+    std::size_t count = 0;
+
+    if (_root != null_proxy) {
+        stack[count++] = _root;
+    }
+
+    while (count) {
+        node const& n = _nodes[stack[--count]];
+
+        // slab test against the node bounds for each segment, axis-aligned
+        // segments have infinite reciprocals which are handled by treating
+        // the slab as infinite if the start is inside it and empty otherwise
+        bool hit[max_packet];
+        bool any_hit = false;
+        for (std::size_t ii = 0; ii < max_packet; ++ii) {
+            float tx0 = (n.aabb[0].x - start_x[ii]) * inverse_delta_x[ii];
+            float tx1 = (n.aabb[1].x - start_x[ii]) * inverse_delta_x[ii];
+            float ty0 = (n.aabb[0].y - start_y[ii]) * inverse_delta_y[ii];
+            float ty1 = (n.aabb[1].y - start_y[ii]) * inverse_delta_y[ii];
+
+            bool inside_x = start_x[ii] >= n.aabb[0].x && start_x[ii] <= n.aabb[1].x;
+            bool inside_y = start_y[ii] >= n.aabb[0].y && start_y[ii] <= n.aabb[1].y;
+            bool finite_x = std::isfinite(inverse_delta_x[ii]);
+            bool finite_y = std::isfinite(inverse_delta_y[ii]);
+
+            float tmin_x = finite_x ? std::min(tx0, tx1) : (inside_x ? 0.f : 2.f);
+            float tmax_x = finite_x ? std::max(tx0, tx1) : (inside_x ? 1.f : -1.f);
+            float tmin_y = finite_y ? std::min(ty0, ty1) : (inside_y ? 0.f : 2.f);
+            float tmax_y = finite_y ? std::max(ty0, ty1) : (inside_y ? 1.f : -1.f);
+
+            float tmin = std::max(0.f, std::max(tmin_x, tmin_y));
+            float tmax = std::min(max_fraction[ii], std::min(tmax_x, tmax_y));
+
+            hit[ii] = tmin <= tmax;
+            any_hit |= hit[ii];
+        }
+        if (!any_hit) {
+            continue;
+        }
+
+        if (n.is_leaf()) {
+            for (std::size_t ii = 0; ii < num_segments; ++ii) {
+                if (hit[ii]) {
+                    // segments blocked at their start keep testing leaves which
+                    // contain the start, so that ties at zero are resolved
+                    max_fraction[ii] = fn(&n - _nodes.data(), ii, max_fraction[ii]);
+                }
+            }
+        } else {
+            assert(count + 2 <= max_stack);
+            stack[count++] = n.children[0];
+            stack[count++] = n.children[1];
+        }
+    }
+}
+
+} // namespace physics
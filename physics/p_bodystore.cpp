@@ -0,0 +1,213 @@
+// p_bodystore.cpp
+//
+
+#include "p_bodystore.h"
+#include "p_shape.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE 1
+#include <xmmintrin.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+//------------------------------------------------------------------------------
+//! Remove the element at `index` by moving the last element into its place
+template<typename T> void swap_erase(std::vector<T>& v, std::size_t index)
+{
+    v[index] = std::move(v.back());
+    v.pop_back();
+}
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+namespace physics {
+
+//------------------------------------------------------------------------------
+std::size_t body_store::push_back(motion const& m,
+                                  float inverse_mass,
+                                  float inverse_inertia,
+                                  material const* material,
+                                  collision_filter const& filter,
+                                  bounds const& b)
+{
+    _shape.push_back(m.get_shape());
+    _material.push_back(material);
+    _collision_filter.push_back(filter);
+
+    _position_x.push_back(m.get_position().x);
+    _position_y.push_back(m.get_position().y);
+    _rotation.push_back(m.get_rotation());
+
+    _linear_velocity_x.push_back(m.get_linear_velocity().x);
+    _linear_velocity_y.push_back(m.get_linear_velocity().y);
+    _angular_velocity.push_back(m.get_angular_velocity());
+
+    _inverse_mass.push_back(inverse_mass);
+    _inverse_inertia.push_back(inverse_inertia);
+
+    _mins_x.push_back(b[0].x);
+    _mins_y.push_back(b[0].y);
+    _maxs_x.push_back(b[1].x);
+    _maxs_y.push_back(b[1].y);
+
+    _awake.push_back(1);
+    _sleep_time.push_back(0.f);
+
+    return _shape.size() - 1;
+}
+
+//------------------------------------------------------------------------------
+void body_store::set_state(std::size_t index,
+                           motion const& m,
+                           float inverse_mass,
+                           float inverse_inertia,
+                           material const* material,
+                           collision_filter const& filter)
+{
+    _shape[index] = m.get_shape();
+    _material[index] = material;
+    _collision_filter[index] = filter;
+
+    set_position(index, m.get_position());
+    _rotation[index] = m.get_rotation();
+
+    set_linear_velocity(index, m.get_linear_velocity());
+    _angular_velocity[index] = m.get_angular_velocity();
+
+    set_inverse_mass(index, inverse_mass, inverse_inertia);
+}
+
+//------------------------------------------------------------------------------
+void body_store::swap_erase(std::size_t index)
+{
+    ::swap_erase(_shape, index);
+    ::swap_erase(_material, index);
+    ::swap_erase(_collision_filter, index);
+
+    ::swap_erase(_position_x, index);
+    ::swap_erase(_position_y, index);
+    ::swap_erase(_rotation, index);
+
+    ::swap_erase(_linear_velocity_x, index);
+    ::swap_erase(_linear_velocity_y, index);
+    ::swap_erase(_angular_velocity, index);
+
+    ::swap_erase(_inverse_mass, index);
+    ::swap_erase(_inverse_inertia, index);
+
+    ::swap_erase(_mins_x, index);
+    ::swap_erase(_mins_y, index);
+    ::swap_erase(_maxs_x, index);
+    ::swap_erase(_maxs_y, index);
+
+    ::swap_erase(_awake, index);
+    ::swap_erase(_sleep_time, index);
+}
+
+//------------------------------------------------------------------------------
+void body_store::update_bounds(std::size_t index)
+{
+    bounds b = _shape[index]->calculate_bounds(mat3::transform(get_position(index), _rotation[index]));
+    _mins_x[index] = b[0].x;
+    _mins_y[index] = b[0].y;
+    _maxs_x[index] = b[1].x;
+    _maxs_y[index] = b[1].y;
+}
+
+//------------------------------------------------------------------------------
+void body_store::integrate(float delta_time)
+{
+    std::size_t ii = 0;
+    std::size_t sz = size();
+
+#if USE_SSE
+    __m128 dt = _mm_set1_ps(delta_time);
+    for (; ii + 4 <= sz; ii += 4) {
+        __m128 px = _mm_loadu_ps(&_position_x[ii]);
+        __m128 py = _mm_loadu_ps(&_position_y[ii]);
+        __m128 r = _mm_loadu_ps(&_rotation[ii]);
+
+        px = _mm_add_ps(px, _mm_mul_ps(_mm_loadu_ps(&_linear_velocity_x[ii]), dt));
+        py = _mm_add_ps(py, _mm_mul_ps(_mm_loadu_ps(&_linear_velocity_y[ii]), dt));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&_angular_velocity[ii]), dt));
+
+        _mm_storeu_ps(&_position_x[ii], px);
+        _mm_storeu_ps(&_position_y[ii], py);
+        _mm_storeu_ps(&_rotation[ii], r);
+    }
+#endif
+
+    for (; ii < sz; ++ii) {
+        _position_x[ii] += _linear_velocity_x[ii] * delta_time;
+        _position_y[ii] += _linear_velocity_y[ii] * delta_time;
+        _rotation[ii] += _angular_velocity[ii] * delta_time;
+    }
+}
+
+//------------------------------------------------------------------------------
+void body_store::integrate(float delta_time, std::vector<std::size_t> const& indices)
+{
+    for (std::size_t ii : indices) {
+        _position_x[ii] += _linear_velocity_x[ii] * delta_time;
+        _position_y[ii] += _linear_velocity_y[ii] * delta_time;
+        _rotation[ii] += _angular_velocity[ii] * delta_time;
+    }
+}
+
+//------------------------------------------------------------------------------
+void body_store::swept_bounds(float delta_time, std::vector<bounds>& out) const
+{
+    static_assert(sizeof(bounds) == 4 * sizeof(float), "unexpected bounds layout");
+
+    std::size_t ii = 0;
+    std::size_t sz = size();
+    out.resize(sz);
+
+#if USE_SSE
+    __m128 dt = _mm_set1_ps(delta_time);
+    for (; ii + 4 <= sz; ii += 4) {
+        __m128 tx = _mm_mul_ps(_mm_loadu_ps(&_linear_velocity_x[ii]), dt);
+        __m128 ty = _mm_mul_ps(_mm_loadu_ps(&_linear_velocity_y[ii]), dt);
+
+        __m128 mins_x = _mm_loadu_ps(&_mins_x[ii]);
+        __m128 mins_y = _mm_loadu_ps(&_mins_y[ii]);
+        __m128 maxs_x = _mm_loadu_ps(&_maxs_x[ii]);
+        __m128 maxs_y = _mm_loadu_ps(&_maxs_y[ii]);
+
+        // equivalent to bounds::from_translation, operands are ordered so
+        // that ties are resolved the same way as std::min and std::max
+        mins_x = _mm_min_ps(_mm_add_ps(mins_x, tx), mins_x);
+        mins_y = _mm_min_ps(_mm_add_ps(mins_y, ty), mins_y);
+        maxs_x = _mm_max_ps(_mm_add_ps(maxs_x, tx), maxs_x);
+        maxs_y = _mm_max_ps(_mm_add_ps(maxs_y, ty), maxs_y);
+
+        // transpose into four consecutive bounds
+        _MM_TRANSPOSE4_PS(mins_x, mins_y, maxs_x, maxs_y);
+        float* dest = reinterpret_cast<float*>(out.data() + ii);
+        _mm_storeu_ps(dest + 0, mins_x);
+        _mm_storeu_ps(dest + 4, mins_y);
+        _mm_storeu_ps(dest + 8, maxs_x);
+        _mm_storeu_ps(dest + 12, maxs_y);
+    }
+#endif
+
+    for (; ii < sz; ++ii) {
+        vec2 translation = get_linear_velocity(ii) * delta_time;
+        out[ii] = bounds::from_translation(get_bounds(ii), translation);
+    }
+}
+
+//------------------------------------------------------------------------------
+void body_store::swept_bounds(float delta_time, std::vector<std::size_t> const& indices, std::vector<bounds>& out) const
+{
+    out.resize(size());
+    for (std::size_t ii : indices) {
+        vec2 translation = get_linear_velocity(ii) * delta_time;
+        out[ii] = bounds::from_translation(get_bounds(ii), translation);
+    }
+}
+
+} // namespace physics
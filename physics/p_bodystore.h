@@ -0,0 +1,165 @@
+// p_bodystore.h
+//
+
+#pragma once
+
+#include "p_motion.h"
+
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace physics {
+
+class material;
+
+//------------------------------------------------------------------------------
+/*
+    Collision filter data which is tested by the world before any callback
+
+    A pair of bodies is only considered for a collision from `a` to `b` if the
+    mask of `a` includes any of the categories of `b` and the bodies are not in
+    the same owner group. Like the filter callback the test is not symmetric.
+*/
+struct collision_filter
+{
+    uint32_t category; //!< Bit mask of categories that the body belongs to
+    uint32_t mask; //!< Bit mask of categories that the body collides with
+    uint64_t group; //!< Bodies with the same non-zero group never collide
+
+    bool collides_with(collision_filter const& other) const {
+        return (mask & other.category) && (!group || group != other.group);
+    }
+};
+
+//! Default filter which collides with everything
+constexpr collision_filter default_collision_filter = {1, UINT32_MAX, 0};
+
+//------------------------------------------------------------------------------
+/*
+    Contiguous structure-of-arrays storage for rigid body state
+
+    Bodies which have been added to a world keep their state here instead of in
+    the rigid_body object so that per-step kernels such as integration and
+    swept bounds generation can process all bodies in a single linear pass.
+    Bodies are stored densely in the same order as the world's body list.
+    Kernels which take a list of indices only process the given bodies, which
+    allows the world to skip bodies that are sleeping.
+*/
+class body_store
+{
+public:
+    std::size_t size() const { return _shape.size(); }
+
+    //! Append state for a new body, returns the index of the body
+    std::size_t push_back(motion const& m,
+                          float inverse_mass,
+                          float inverse_inertia,
+                          material const* material,
+                          collision_filter const& filter,
+                          bounds const& b);
+
+    //! Replace the state of the body at `index`, cached bounds are not updated
+    void set_state(std::size_t index,
+                   motion const& m,
+                   float inverse_mass,
+                   float inverse_inertia,
+                   material const* material,
+                   collision_filter const& filter);
+
+    //! Remove the body at `index` and move the last body into its place
+    void swap_erase(std::size_t index);
+
+    //! Return a copy of the motion state for the body at `index`
+    motion get_motion(std::size_t index) const {
+        return motion(_shape[index],
+                      get_position(index),
+                      _rotation[index],
+                      get_linear_velocity(index),
+                      _angular_velocity[index]);
+    }
+
+    shape const* get_shape(std::size_t index) const { return _shape[index]; }
+    material const* get_material(std::size_t index) const { return _material[index]; }
+
+    collision_filter const& get_collision_filter(std::size_t index) const { return _collision_filter[index]; }
+    void set_collision_filter(std::size_t index, collision_filter const& filter) { _collision_filter[index] = filter; }
+
+    vec2 get_position(std::size_t index) const { return vec2(_position_x[index], _position_y[index]); }
+    void set_position(std::size_t index, vec2 position) { _position_x[index] = position.x; _position_y[index] = position.y; }
+
+    float get_rotation(std::size_t index) const { return _rotation[index]; }
+    void set_rotation(std::size_t index, float rotation) { _rotation[index] = rotation; }
+
+    vec2 get_linear_velocity(std::size_t index) const { return vec2(_linear_velocity_x[index], _linear_velocity_y[index]); }
+    void set_linear_velocity(std::size_t index, vec2 v) { _linear_velocity_x[index] = v.x; _linear_velocity_y[index] = v.y; }
+
+    float get_angular_velocity(std::size_t index) const { return _angular_velocity[index]; }
+    void set_angular_velocity(std::size_t index, float w) { _angular_velocity[index] = w; }
+
+    float get_inverse_mass(std::size_t index) const { return _inverse_mass[index]; }
+    float get_inverse_inertia(std::size_t index) const { return _inverse_inertia[index]; }
+
+    void set_inverse_mass(std::size_t index, float inverse_mass, float inverse_inertia) {
+        _inverse_mass[index] = inverse_mass;
+        _inverse_inertia[index] = inverse_inertia;
+    }
+
+    //! True if the body at `index` is simulated during each step
+    bool is_awake(std::size_t index) const { return _awake[index] != 0; }
+    void set_awake(std::size_t index, bool awake) { _awake[index] = awake ? 1 : 0; }
+
+    //! Time that the body at `index` has been moving slowly enough to sleep
+    float get_sleep_time(std::size_t index) const { return _sleep_time[index]; }
+    void set_sleep_time(std::size_t index, float sleep_time) { _sleep_time[index] = sleep_time; }
+
+    //! Return the cached world-space bounds of the body at `index`
+    bounds get_bounds(std::size_t index) const {
+        return bounds(vec2(_mins_x[index], _mins_y[index]), vec2(_maxs_x[index], _maxs_y[index]));
+    }
+
+    //! Recalculate the cached bounds of the body at `index` from its shape
+    //! and current position and rotation.
+    void update_bounds(std::size_t index);
+
+    //! Advance positions and rotations of all bodies by `delta_time`
+    void integrate(float delta_time);
+
+    //! Advance positions and rotations of the bodies in `indices`
+    void integrate(float delta_time, std::vector<std::size_t> const& indices);
+
+    //! Calculate the bounds swept by each body over `delta_time` assuming
+    //! linear motion, results are written to `out` in body order.
+    void swept_bounds(float delta_time, std::vector<bounds>& out) const;
+
+    //! Calculate the swept bounds of the bodies in `indices`, results are
+    //! written to `out` at the index of each body and other entries of `out`
+    //! are left unchanged.
+    void swept_bounds(float delta_time, std::vector<std::size_t> const& indices, std::vector<bounds>& out) const;
+
+protected:
+    std::vector<shape const*> _shape;
+    std::vector<material const*> _material;
+    std::vector<collision_filter> _collision_filter;
+
+    std::vector<float> _position_x;
+    std::vector<float> _position_y;
+    std::vector<float> _rotation;
+
+    std::vector<float> _linear_velocity_x;
+    std::vector<float> _linear_velocity_y;
+    std::vector<float> _angular_velocity;
+
+    std::vector<float> _inverse_mass;
+    std::vector<float> _inverse_inertia;
+
+    std::vector<float> _mins_x;
+    std::vector<float> _mins_y;
+    std::vector<float> _maxs_x;
+    std::vector<float> _maxs_y;
+
+    std::vector<uint8_t> _awake;
+    std::vector<float> _sleep_time;
+};
+
+} // namespace physics
@@ -0,0 +1,254 @@
+// p_broadphase.cpp
+//
+
+#include "p_broadphase.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace physics {
+
+//------------------------------------------------------------------------------
+broadphase::proxy broadphase::insert(bounds const& b)
+{
+    proxy id;
+    if (_free_proxies.size()) {
+        id = _free_proxies.back();
+        _free_proxies.pop_back();
+    } else {
+        id = _proxies.size();
+        _proxies.push_back({});
+    }
+
+    assert(id < (1ULL << 31));
+
+    // append endpoints at the far end of each axis and sort them into place
+    _proxies[id].aabb = bounds(vec2(FLT_MAX), vec2(FLT_MAX));
+    for (int axis = 0; axis < 2; ++axis) {
+        for (int ii = 0; ii < 2; ++ii) {
+            _proxies[id].endpoints[axis][ii] = _endpoints[axis].size();
+            _endpoints[axis].push_back({FLT_MAX, uint32_t(id << 1 | ii)});
+        }
+    }
+
+    update(id, b);
+    return id;
+}
+
+//------------------------------------------------------------------------------
+void broadphase::remove(proxy id)
+{
+    // move endpoints to the far end of each axis, this removes all pairs
+    update(id, bounds(vec2(FLT_MAX), vec2(FLT_MAX)));
+
+    for (int axis = 0; axis < 2; ++axis) {
+        assert(_proxies[id].endpoints[axis][1] == _endpoints[axis].size() - 1);
+        assert(_proxies[id].endpoints[axis][0] == _endpoints[axis].size() - 2);
+        _endpoints[axis].resize(_endpoints[axis].size() - 2);
+    }
+
+    _free_proxies.push_back(id);
+}
+
+//------------------------------------------------------------------------------
+void broadphase::update(proxy id, bounds const& b)
+{
+    assert(!isnan(b[0]) && !isnan(b[1]));
+
+    bounds old_bounds = _proxies[id].aabb;
+    _proxies[id].aabb = b;
+
+    sort(id, old_bounds);
+}
+
+//------------------------------------------------------------------------------
+void broadphase::update(std::vector<std::pair<proxy, bounds>> const& updates)
+{
+    std::size_t max_crossings = _endpoints[0].size();
+    _num_crossings = 0;
+
+    for (std::size_t ii = 0; ii < updates.size(); ++ii) {
+        proxy id = updates[ii].first;
+        bounds const& b = updates[ii].second;
+        assert(!isnan(b[0]) && !isnan(b[1]));
+
+        bounds old_bounds = _proxies[id].aabb;
+        _proxies[id].aabb = b;
+
+        if (_num_crossings > max_crossings) {
+            // move remaining proxies without sorting, then rebuild everything
+            for (++ii; ii < updates.size(); ++ii) {
+                _proxies[updates[ii].first].aabb = updates[ii].second;
+            }
+            rebuild();
+            return;
+        }
+
+        sort(id, old_bounds);
+    }
+}
+
+//------------------------------------------------------------------------------
+void broadphase::sort(proxy id, bounds const& old_bounds)
+{
+    bounds const& b = _proxies[id].aabb;
+
+    for (int axis = 0; axis < 2; ++axis) {
+        std::size_t const* endpoints = _proxies[id].endpoints[axis];
+        _endpoints[axis][endpoints[0]].value = b[0][axis];
+        _endpoints[axis][endpoints[1]].value = b[1][axis];
+
+        // the order in which endpoints are sorted guarantees that min and
+        // max endpoints of the same proxy never need to be swapped
+        float dmin = b[0][axis] - old_bounds[0][axis];
+        float dmax = b[1][axis] - old_bounds[1][axis];
+
+        if (dmin < 0.f) {
+            sort_down(axis, endpoints[0]);
+        }
+        if (dmax > 0.f) {
+            sort_up(axis, endpoints[1]);
+        }
+        if (dmin > 0.f) {
+            sort_up(axis, endpoints[0]);
+        }
+        if (dmax < 0.f) {
+            sort_down(axis, endpoints[1]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void broadphase::sort_down(int axis, std::size_t index)
+{
+    std::vector<endpoint>& list = _endpoints[axis];
+    endpoint e = list[index];
+
+    for (; index > 0 && e < list[index - 1]; --index) {
+        endpoint const& other = list[index - 1];
+        assert(other.id() != e.id());
+
+        if (!e.is_max() && other.is_max()) {
+            // min endpoint moved below a max endpoint, start of overlap
+            if (_proxies[e.id()].aabb.intersects(_proxies[other.id()].aabb)) {
+                add_pair(e.id(), other.id());
+            }
+        } else if (e.is_max() && !other.is_max()) {
+            // max endpoint moved below a min endpoint, end of overlap. pairs
+            // only exist while proxies overlap on both axes, so skip the pair
+            // lookup if they do not overlap on the other axis.
+            if (overlaps(axis ^ 1, e.id(), other.id())) {
+                remove_pair(e.id(), other.id());
+            }
+        }
+
+        _proxies[other.id()].endpoints[axis][other.is_max()] = index;
+        list[index] = other;
+        ++_num_crossings;
+    }
+
+    _proxies[e.id()].endpoints[axis][e.is_max()] = index;
+    list[index] = e;
+}
+
+//------------------------------------------------------------------------------
+void broadphase::sort_up(int axis, std::size_t index)
+{
+    std::vector<endpoint>& list = _endpoints[axis];
+    endpoint e = list[index];
+
+    for (; index + 1 < list.size() && list[index + 1] < e; ++index) {
+        endpoint const& other = list[index + 1];
+        assert(other.id() != e.id());
+
+        if (e.is_max() && !other.is_max()) {
+            // max endpoint moved above a min endpoint, start of overlap
+            if (_proxies[e.id()].aabb.intersects(_proxies[other.id()].aabb)) {
+                add_pair(e.id(), other.id());
+            }
+        } else if (!e.is_max() && other.is_max()) {
+            // min endpoint moved above a max endpoint, end of overlap
+            if (overlaps(axis ^ 1, e.id(), other.id())) {
+                remove_pair(e.id(), other.id());
+            }
+        }
+
+        _proxies[other.id()].endpoints[axis][other.is_max()] = index;
+        list[index] = other;
+        ++_num_crossings;
+    }
+
+    _proxies[e.id()].endpoints[axis][e.is_max()] = index;
+    list[index] = e;
+}
+
+//------------------------------------------------------------------------------
+void broadphase::rebuild()
+{
+    // endpoints of moved proxies still hold their old values
+    for (int axis = 0; axis < 2; ++axis) {
+        for (auto& e : _endpoints[axis]) {
+            e.value = _proxies[e.id()].aabb[e.is_max()][axis];
+        }
+
+        std::sort(_endpoints[axis].begin(), _endpoints[axis].end());
+
+        for (std::size_t ii = 0; ii < _endpoints[axis].size(); ++ii) {
+            endpoint const& e = _endpoints[axis][ii];
+            _proxies[e.id()].endpoints[axis][e.is_max()] = ii;
+        }
+    }
+
+    _pairs.clear();
+    _pair_index.clear();
+
+    // sweep along the x-axis and test active proxies on the y-axis
+    std::vector<proxy> active;
+    for (endpoint const& e : _endpoints[0]) {
+        if (!e.is_max()) {
+            for (proxy other : active) {
+                if (overlaps(1, e.id(), other)) {
+                    add_pair(e.id(), other);
+                }
+            }
+            active.push_back(e.id());
+        } else {
+            auto it = std::find(active.begin(), active.end(), e.id());
+            assert(it != active.end());
+            *it = active.back();
+            active.pop_back();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void broadphase::add_pair(proxy a, proxy b)
+{
+    // a pair can start overlapping on both axes during the same update
+    auto result = _pair_index.emplace(pair_key(a, b), _pairs.size());
+    if (result.second) {
+        _pairs.push_back(a < b ? pair{a, b} : pair{b, a});
+    }
+}
+
+//------------------------------------------------------------------------------
+void broadphase::remove_pair(proxy a, proxy b)
+{
+    auto it = _pair_index.find(pair_key(a, b));
+    if (it == _pair_index.end()) {
+        return;
+    }
+
+    // swap with the last pair and update its index
+    std::size_t index = it->second;
+    _pair_index.erase(it);
+    if (index != _pairs.size() - 1) {
+        _pairs[index] = _pairs.back();
+        _pair_index[pair_key(_pairs[index].first, _pairs[index].second)] = index;
+    }
+    _pairs.pop_back();
+}
+
+} // namespace physics
@@ -0,0 +1,122 @@
+// p_broadphase.h
+//
+
+#pragma once
+
+#include "cm_bounds.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace physics {
+
+//------------------------------------------------------------------------------
+/*
+    Incremental sweep-and-prune broadphase
+
+    The bounds of each proxy are projected onto both axes as lists of sorted
+    endpoints which persist between updates. Updating a proxy only re-sorts its
+    own endpoints with insertion sort, which is nearly free when proxies move
+    coherently from step to step. Whenever a min endpoint crosses a max endpoint
+    the pair either starts or stops overlapping on that axis, so the set of
+    overlapping pairs is maintained from these events instead of being rebuilt.
+
+    Insertion sort degrades when proxies move far relative to their neighbors,
+    e.g. fast projectiles, so batched updates which cross too many endpoints
+    fall back to a full sort and sweep of both axes.
+*/
+class broadphase
+{
+public:
+    using proxy = std::size_t;
+    using pair = std::pair<proxy, proxy>;
+
+    //! Insert a new proxy with the given bounds, returns the proxy id
+    proxy insert(bounds const& b);
+
+    //! Remove a proxy and all of its overlapping pairs
+    void remove(proxy id);
+
+    //! Move a proxy to new bounds and update its overlapping pairs
+    void update(proxy id, bounds const& b);
+
+    //! Move several proxies to new bounds and update overlapping pairs, the
+    //! proxies are sorted incrementally unless the number of endpoints crossed
+    //! exceeds the number of endpoints on an axis, in which case all pairs
+    //! are rebuilt from scratch.
+    void update(std::vector<std::pair<proxy, bounds>> const& updates);
+
+    bounds const& get_bounds(proxy id) const {
+        return _proxies[id].aabb;
+    }
+
+    //! Return all pairs of proxies with intersecting bounds in arbitrary
+    //! order, each pair is listed once with `first < second`.
+    std::vector<pair> const& pairs() const {
+        return _pairs;
+    }
+
+protected:
+    //! Endpoint value and owning proxy, the lowest bit of `data` is set for
+    //! max endpoints and the remaining bits contain the proxy id.
+    struct endpoint
+    {
+        float value;
+        uint32_t data;
+
+        proxy id() const { return data >> 1; }
+        bool is_max() const { return data & 1; }
+
+        //! Sort by value, min endpoints sort before max endpoints with the
+        //! same value so that touching bounds are considered overlapping.
+        bool operator<(endpoint const& other) const {
+            return value < other.value || (value == other.value && is_max() < other.is_max());
+        }
+    };
+
+    struct proxy_data
+    {
+        bounds aabb;
+        //! Index of the min and max endpoint for each axis
+        std::size_t endpoints[2][2];
+    };
+
+    std::vector<endpoint> _endpoints[2];
+    std::vector<proxy_data> _proxies;
+    std::vector<proxy> _free_proxies;
+
+    std::vector<pair> _pairs;
+    //! Index into `_pairs` by pair key
+    std::unordered_map<uint64_t, std::size_t> _pair_index;
+
+    //! Number of endpoints crossed by insertion sort since the last reset
+    std::size_t _num_crossings = 0;
+
+protected:
+    void sort(proxy id, bounds const& old_bounds);
+    void sort_down(int axis, std::size_t index);
+    void sort_up(int axis, std::size_t index);
+
+    //! Sort all endpoints and rebuild all pairs by sweeping along one axis
+    void rebuild();
+
+    //! Returns true if the endpoints of `a` and `b` overlap on the given axis,
+    //! compares endpoint indices so it is only valid while `axis` is sorted.
+    bool overlaps(int axis, proxy a, proxy b) const {
+        std::size_t const* ea = _proxies[a].endpoints[axis];
+        std::size_t const* eb = _proxies[b].endpoints[axis];
+        return ea[0] < eb[1] && eb[0] < ea[1];
+    }
+
+    void add_pair(proxy a, proxy b);
+    void remove_pair(proxy a, proxy b);
+
+    static uint64_t pair_key(proxy a, proxy b) {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+};
+
+} // namespace physics
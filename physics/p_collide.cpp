@@ -15,131 +15,164 @@
 ////////////////////////////////////////////////////////////////////////////////
 namespace physics {
 
-//------------------------------------------------------------------------------
-collide::motion_data::motion_data(motion const& motion)
-    : physics::motion(motion)
-{
-    local_to_world = mat3::transform(_position, _rotation);
-    world_to_local = mat3::inverse_transform(_position, _rotation);
-}
+namespace {
 
 //------------------------------------------------------------------------------
-vec2 collide::closest_point(shape const* shape, vec2 point)
+//! Signed distance from `point` to the boundary of `polygon`, negative if the
+//! point is inside the polygon. `closest` receives the nearest point on the
+//! boundary and `normal` the outward normal of the boundary at `closest`.
+float polygon_point_distance(polygon_vertices const& polygon, vec2 point, vec2& closest, vec2& normal)
 {
-    static circle_shape point_shape(0.f);
-    motion point_motion{&point_shape, point};
+    std::size_t edge = 0;
+    float separation = -FLT_MAX;
+    normal = vec2_zero;
+
+    // find the edge with the maximum separation from the point
+    for (std::size_t ii = 0; ii < polygon.size(); ++ii) {
+        vec2 n = polygon.normal(ii);
+        float s = n.dot(point - polygon[ii]);
+        if (n != vec2_zero && s > separation) {
+            separation = s;
+            normal = n;
+            edge = ii;
+        }
+    }
 
-    if (shape->type() == shape_type::compound) {
-        float best_distance = FLT_MAX;
-        vec2 best_point = vec2_zero;
-        for (auto& child : *static_cast<compound_shape const*>(shape)) {
-            motion shape_motion{
-                child.shape.get(),
-                child.position,
-                child.rotation
-            };
-            collide c(shape_motion, point_motion);
-            float distance = (c.get_contact().point - point).length_sqr();
-            if (distance < best_distance) {
-                best_distance = distance;
-                best_point = c.get_contact().point;
+    vec2 v1 = polygon[edge];
+    vec2 v2 = polygon[edge + 1];
+
+    // point is outside the polygon and nearest to one of the edge vertices
+    if (separation > 0.f) {
+        bool in_vertex_region = true;
+        vec2 v = v1;
+        if ((point - v1).dot(v2 - v1) <= 0.f) {
+            v = v1;
+        } else if ((point - v2).dot(v1 - v2) <= 0.f) {
+            v = v2;
+        } else {
+            in_vertex_region = false;
+        }
+
+        if (in_vertex_region) {
+            vec2 n = point - v;
+            float distance = n.normalize_length();
+            if (distance > 0.f) {
+                closest = v;
+                normal = n;
+                return distance;
             }
         }
-        return best_point;
-    } else {
-        motion shape_motion{shape};
-        collide c(shape_motion, point_motion);
-        return c.get_contact().point;
     }
+
+    // point is nearest to the interior of the edge
+    closest = point - normal * separation;
+    return separation;
 }
 
 //------------------------------------------------------------------------------
-collide::collide(motion const& motion_a, motion const& motion_b)
-    : _motion{motion_a, motion_b}
+//! Penetrating contact between the reference edge `edge` of polygon `a` and
+//! the most anti-parallel edge of polygon `b`. The incident edge is clipped to
+//! the extent of the reference edge and `point_b` receives the average of the
+//! clipped points which are behind the reference edge.
+void polygon_clip(vec2 const* a, std::size_t edge, vec2 const* b, std::size_t num_b, vec2& point_b)
 {
-    vec3 position = vec3_zero;
-    vec3 direction = vec3(_motion[1].get_position() - _motion[0].get_position());
-
-    float distance = minimum_distance(position, direction);
+    vec2 tangent = (a[edge + 1] - a[edge]).normalize();
+    vec2 normal = tangent.cross(1.f);
+
+    // find the incident edge on `b`
+    std::size_t incident = 0;
+    float min_dot = FLT_MAX;
+    for (std::size_t ii = 0; ii < num_b; ++ii) {
+        float d = normal.dot((b[ii + 1] - b[ii]).cross(1.f).normalize());
+        if (d < min_dot) {
+            min_dot = d;
+            incident = ii;
+        }
+    }
 
-    // Calculate the relative velocity of the bodies at the contact point
-    vec3 relative_velocity = vec3(_motion[1].get_linear_velocity(position.to_vec2()))
-                           - vec3(_motion[0].get_linear_velocity(position.to_vec2()));
+    // clip the incident edge against the side planes of the reference edge
+    vec2 points[2] = {b[incident], b[incident + 1]};
+    float lower = tangent.dot(a[edge]);
+    float upper = tangent.dot(a[edge + 1]);
+    float d0 = tangent.dot(points[0]);
+    float d1 = tangent.dot(points[1]);
+
+    if (d0 != d1) {
+        float t0 = (lower - d0) / (d1 - d0);
+        float t1 = (upper - d0) / (d1 - d0);
+        float tmin = std::max(0.f, std::min(t0, t1));
+        float tmax = std::min(1.f, std::max(t0, t1));
+        vec2 v = points[1] - points[0];
+        points[1] = points[0] + v * std::max(tmin, tmax);
+        points[0] = points[0] + v * std::min(tmin, tmax);
+    }
 
-    if (distance < 0.0f && relative_velocity.dot(direction) < 0.f) {
-        _has_contact = true;
+    // average the clipped points behind the reference edge
+    float s0 = normal.dot(points[0] - a[edge]);
+    float s1 = normal.dot(points[1] - a[edge]);
+    if (s0 <= 0.f && s1 <= 0.f) {
+        point_b = (points[0] + points[1]) * .5f;
     } else {
-        _has_contact = false;
+        point_b = s0 < s1 ? points[0] : points[1];
     }
-
-    _contact.distance = distance;
-    _contact.point = position.to_vec2();
-    _contact.normal = direction.to_vec2();
-    assert(!isnan(_contact.distance));
-    assert(!isnan(_contact.point));
-    assert(!isnan(_contact.normal));
 }
 
 //------------------------------------------------------------------------------
-float collide::minimum_distance(vec3& point, vec3& direction) const
+//! Rigid transform and support mapping of a shape of type `shape_type`. For
+//! concrete shape types the support mapping is resolved at compile time.
+template<typename shape_type> class shape_transform
 {
-    support_vertex simplex[2], candidate;
-
-    simplex[0] = supporting_vertex(direction);
-    simplex[1] = supporting_vertex(-simplex[0].d);
-    direction = -nearest_difference(simplex[0], simplex[1]);
-    float distance = direction.length_sqr();
-
-    for (int num_iterations = 0; ; ++num_iterations) {
-        candidate = supporting_vertex(direction);
-
-        // Check if simplex formed with candidate contains origin
-        if (triangle_contains_origin(simplex[0].d, simplex[1].d, candidate.d)) {
-            return -penetration_distance(simplex[0], simplex[1], candidate, point, direction);
-        }
+public:
+    shape_transform(motion const& motion)
+        : _shape(static_cast<shape_type const*>(motion.get_shape()))
+        , _position(motion.get_position())
+        , _cos(std::cos(motion.get_rotation()))
+        , _sin(std::sin(motion.get_rotation()))
+    {}
+
+    shape_type const* get_shape() const { return _shape; }
+
+    vec2 to_world(vec2 direction) const {
+        return vec2(direction.x * _cos - direction.y * _sin,
+                    direction.x * _sin + direction.y * _cos);
+    }
 
-        // Update simplex
-        vec3 d0 = nearest_difference(simplex[0], candidate);
-        vec3 d1 = nearest_difference(simplex[1], candidate);
+    vec2 to_local(vec2 direction) const {
+        return vec2(direction.x * _cos + direction.y * _sin,
+                    direction.y * _cos - direction.x * _sin);
+    }
 
-        if (d0.length_sqr() < d1.length_sqr()) {
-            simplex[1] = candidate;
-            direction = -d0;
-        } else {
-            simplex[0] = candidate;
-            direction = -d1;
-        }
+    vec2 point_to_world(vec2 point) const {
+        return to_world(point) + _position;
+    }
 
-        float d = direction.length_sqr();
+    vec2 point_to_local(vec2 point) const {
+        return to_local(point) - to_local(_position);
+    }
 
-        // Check progress
-        if (std::min(distance - d, d) < epsilon || num_iterations >= max_iterations) {
-            point = nearest_point(simplex[0], simplex[1]);
-            return direction.normalize_length();
-        } else {
-            distance = d;
-        }
+    vec3 supporting_vertex(vec3 direction) const {
+        vec2 local_vertex = _shape->supporting_vertex(to_local(direction.to_vec2()));
+        return vec3(point_to_world(local_vertex), 1);
     }
-}
 
-//------------------------------------------------------------------------------
-collide::support_vertex collide::supporting_vertex(vec3 direction) const
-{
-    vec3 a = motion_supporting_vertex(_motion[0],  direction);
-    vec3 b = motion_supporting_vertex(_motion[1], -direction);
-    return {a, b, a - b};
-}
+protected:
+    shape_type const* _shape;
+    vec2 _position;
+    float _cos;
+    float _sin;
+};
 
 //------------------------------------------------------------------------------
-vec3 collide::motion_supporting_vertex(motion_data const& motion, vec3 direction) const
+struct support_vertex
 {
-    vec2 local_direction = (direction * motion.world_to_local).to_vec2();
-    vec2 local_vertex = motion.get_shape()->supporting_vertex(local_direction);
-    return vec3(local_vertex, 1) * motion.local_to_world;
-}
+    vec3 a; //!< point on object A
+    vec3 b; //!< point on object B
+    vec3 d; //!< "Minkowski difference"; a - b
+    vec3 direction; //!< search direction which produced this vertex
+};
 
 //------------------------------------------------------------------------------
-vec3 collide::nearest_difference(support_vertex a, support_vertex b) const
+vec3 nearest_difference(support_vertex a, support_vertex b)
 {
     vec3 v = b.d - a.d;
     float num = -a.d.dot(v);
@@ -155,9 +188,8 @@ vec3 collide::nearest_difference(support_vertex a, support_vertex b) const
         return a.d * s + b.d * t;
     }
 }
-
 //------------------------------------------------------------------------------
-vec3 collide::nearest_point(support_vertex a, support_vertex b) const
+vec3 nearest_point(support_vertex a, support_vertex b)
 {
     vec3 v = b.d - a.d;
     float num = -a.d.dot(v);
@@ -173,9 +205,8 @@ vec3 collide::nearest_point(support_vertex a, support_vertex b) const
         return a.a * s + b.a * t;
     }
 }
-
 //------------------------------------------------------------------------------
-bool collide::triangle_contains_origin(vec3 a, vec3 b, vec3 c) const
+bool triangle_contains_origin(vec3 a, vec3 b, vec3 c)
 {
     // Triangle plane normal
     vec3 n = (b - a).cross(c - b);
@@ -198,9 +229,134 @@ bool collide::triangle_contains_origin(vec3 a, vec3 b, vec3 c) const
         return true;
     }
 }
+//------------------------------------------------------------------------------
+std::size_t nearest_edge_index(vec3 normal, support_vertex const* vertices, std::size_t num_vertices, vec3& direction)
+{
+    float min_dist_sqr = FLT_MAX;
+    std::size_t min_index = 1;
+
+    for (std::size_t ii = 1; ii < num_vertices; ++ii) {
+        vec3 edge_normal = normal.cross(vertices[ii-1].d - vertices[ii].d);
+        float dot_product = edge_normal.dot(vertices[ii].d);
+
+        float dist_sqr = dot_product * dot_product / edge_normal.length_sqr();
+
+        if (dist_sqr < min_dist_sqr) {
+            min_dist_sqr = dist_sqr;
+            direction = edge_normal;
+            min_index = ii;
+        }
+    }
+
+    return min_index;
+}
+//------------------------------------------------------------------------------
+//! GJK and EPA for any pair of shapes using virtual support mapping.
+class gjk
+{
+public:
+    gjk(motion const& motion_a, motion const& motion_b)
+        : _a(motion_a)
+        , _b(motion_b)
+    {}
+
+    float minimum_distance(vec3& point, vec3& direction, simplex_cache* cache) const;
+
+protected:
+    shape_transform<shape> _a;
+    shape_transform<shape> _b;
+
+    constexpr static int max_iterations = 64;
+    constexpr static int max_vertices = 64;
+    constexpr static float epsilon = 1e-12f;
+    constexpr static float relative_epsilon = 1e-5f;
+
+protected:
+    support_vertex supporting_vertex(vec3 direction) const {
+        vec3 a = _a.supporting_vertex( direction);
+        vec3 b = _b.supporting_vertex(-direction);
+        return {a, b, a - b, direction};
+    }
+
+    void write_cache(simplex_cache& cache, support_vertex const (&simplex)[2]) const {
+        cache.shape_a = _a.get_shape();
+        cache.shape_b = _b.get_shape();
+        cache.directions[0] = _a.to_local(simplex[0].direction.to_vec2());
+        cache.directions[1] = _a.to_local(simplex[1].direction.to_vec2());
+    }
+
+    float penetration_distance(support_vertex a, support_vertex b, support_vertex c, vec3& point, vec3& direction) const;
+};
+
+//------------------------------------------------------------------------------
+float gjk::minimum_distance(vec3& point, vec3& direction, simplex_cache* cache) const
+{
+    support_vertex simplex[2], candidate;
+
+    vec3 initial_direction = direction;
+    float distance = 0.f;
+
+    if (cache && cache->shape_a) {
+        // warm start from the search directions of the previous query, these
+        // are relative to body A so that they follow the rotation of the pair
+        simplex[0] = supporting_vertex(vec3(_a.to_world(cache->directions[0])));
+        simplex[1] = supporting_vertex(vec3(_a.to_world(cache->directions[1])));
+        // replace the second vertex if both directions found the same vertex
+        if ((simplex[1].d - simplex[0].d).length_sqr() < epsilon) {
+            simplex[1] = supporting_vertex(-simplex[0].d);
+        }
+        direction = -nearest_difference(simplex[0], simplex[1]);
+        distance = direction.length_sqr();
+    }
+
+    // start from scratch if the cached simplex touches the origin since it
+    // does not provide a search direction
+    if (distance < epsilon) {
+        simplex[0] = supporting_vertex(initial_direction);
+        simplex[1] = supporting_vertex(-simplex[0].d);
+        direction = -nearest_difference(simplex[0], simplex[1]);
+        distance = direction.length_sqr();
+    }
+
+    for (int num_iterations = 0; ; ++num_iterations) {
+        candidate = supporting_vertex(direction);
+
+        // Check if simplex formed with candidate contains origin
+        if (triangle_contains_origin(simplex[0].d, simplex[1].d, candidate.d)) {
+            if (cache) {
+                write_cache(*cache, simplex);
+            }
+            return -penetration_distance(simplex[0], simplex[1], candidate, point, direction);
+        }
+
+        // Update simplex
+        vec3 d0 = nearest_difference(simplex[0], candidate);
+        vec3 d1 = nearest_difference(simplex[1], candidate);
 
+        if (d0.length_sqr() < d1.length_sqr()) {
+            simplex[1] = candidate;
+            direction = -d0;
+        } else {
+            simplex[0] = candidate;
+            direction = -d1;
+        }
+
+        float d = direction.length_sqr();
+
+        // Check progress
+        if (std::min(distance - d, d) < epsilon || num_iterations >= max_iterations) {
+            if (cache) {
+                write_cache(*cache, simplex);
+            }
+            point = nearest_point(simplex[0], simplex[1]);
+            return direction.normalize_length();
+        } else {
+            distance = d;
+        }
+    }
+}
 //------------------------------------------------------------------------------
-float collide::penetration_distance(support_vertex a, support_vertex b, support_vertex c, vec3& point, vec3& direction) const
+float gjk::penetration_distance(support_vertex a, support_vertex b, support_vertex c, vec3& point, vec3& direction) const
 {
     std::array<support_vertex, max_vertices> vertices;
     std::size_t num_vertices = 0;
@@ -224,7 +380,10 @@ float collide::penetration_distance(support_vertex a, support_vertex b, support_
         float edge_distance = vertices[edge_index].d.dot(direction);
         float point_distance = candidate.d.dot(direction);
         float delta_sqr = (point_distance - edge_distance) * (point_distance - edge_distance) / direction.length_sqr();
-        if (delta_sqr < epsilon || num_vertices == max_vertices) {
+        // also stop if the candidate does not expand the polygon by a significant
+        // fraction of its distance, further expansion only adds degenerate edges
+        bool converged = point_distance - edge_distance <= relative_epsilon * point_distance;
+        if (delta_sqr < epsilon || converged || num_vertices == max_vertices) {
             point = nearest_point(vertices[edge_index], vertices[edge_index-1]);
             return edge_distance / direction.normalize_length();
         }
@@ -236,27 +395,234 @@ float collide::penetration_distance(support_vertex a, support_vertex b, support_
                     vertices.data() + num_vertices);
     }
 }
+//------------------------------------------------------------------------------
+float gjk_contact(motion const& motion_a, motion const& motion_b, vec3& point, vec3& direction, simplex_cache* cache)
+{
+    return gjk(motion_a, motion_b).minimum_distance(point, direction, cache);
+}
 
 //------------------------------------------------------------------------------
-std::size_t collide::nearest_edge_index(vec3 normal, support_vertex const* vertices, std::size_t num_vertices, vec3& direction) const
+float circle_circle_contact(motion const& motion_a, motion const& motion_b, vec3& point, vec3& direction, simplex_cache* /*cache*/)
 {
-    float min_dist_sqr = FLT_MAX;
-    std::size_t min_index = 1;
+    float radius_a = static_cast<circle_shape const*>(motion_a.get_shape())->radius();
+    float radius_b = static_cast<circle_shape const*>(motion_b.get_shape())->radius();
 
-    for (std::size_t ii = 1; ii < num_vertices; ++ii) {
-        vec3 edge_normal = normal.cross(vertices[ii-1].d - vertices[ii].d);
-        float dot_product = edge_normal.dot(vertices[ii].d);
+    vec2 normal = motion_b.get_position() - motion_a.get_position();
+    float distance = normal.normalize_length();
+    if (distance == 0.f) {
+        normal = vec2(1,0);
+    }
 
-        float dist_sqr = dot_product * dot_product / edge_normal.length_sqr();
+    point = vec3(motion_a.get_position() + normal * radius_a, 1);
+    direction = vec3(normal);
+    return distance - radius_a - radius_b;
+}
 
-        if (dist_sqr < min_dist_sqr) {
-            min_dist_sqr = dist_sqr;
-            direction = edge_normal;
-            min_index = ii;
+//------------------------------------------------------------------------------
+float convex_circle_contact(motion const& motion_a, motion const& motion_b, vec3& point, vec3& direction, simplex_cache* /*cache*/)
+{
+    shape_transform<shape> transform(motion_a);
+    polygon_vertices polygon(motion_a.get_shape());
+    float radius = static_cast<circle_shape const*>(motion_b.get_shape())->radius();
+
+    vec2 center = transform.point_to_local(motion_b.get_position());
+    vec2 closest, normal;
+    float distance = polygon_point_distance(polygon, center, closest, normal);
+
+    point = vec3(transform.point_to_world(closest), 1);
+    direction = vec3(transform.to_world(normal));
+    return distance - radius;
+}
+
+//------------------------------------------------------------------------------
+float circle_convex_contact(motion const& motion_a, motion const& motion_b, vec3& point, vec3& direction, simplex_cache* cache)
+{
+    float distance = convex_circle_contact(motion_b, motion_a, point, direction, cache);
+
+    // reverse the normal so that it points from the circle to the polygon
+    float radius = static_cast<circle_shape const*>(motion_a.get_shape())->radius();
+    direction = -direction;
+    point = vec3(motion_a.get_position(), 1) + direction * radius;
+    return distance;
+}
+
+//------------------------------------------------------------------------------
+//! Maximum separation of the vertices of box B from the edges of box A, where
+//! `vertices` are the vertices of B in the local space of A. `edge` receives
+//! the index of the edge with maximum separation, as in `polygon_vertices`.
+float box_separation(vec2 half_size, vec2 const (&vertices)[4], std::size_t& edge)
+{
+    vec2 mins = vertices[0];
+    vec2 maxs = vertices[0];
+    for (std::size_t ii = 1; ii < 4; ++ii) {
+        mins = vec2(std::min(mins.x, vertices[ii].x), std::min(mins.y, vertices[ii].y));
+        maxs = vec2(std::max(maxs.x, vertices[ii].x), std::max(maxs.y, vertices[ii].y));
+    }
+
+    float separation[4] = {
+        -maxs.y - half_size.y,
+        mins.x - half_size.x,
+        mins.y - half_size.y,
+        -maxs.x - half_size.x,
+    };
+
+    edge = std::max_element(separation, separation + 4) - separation;
+    return separation[edge];
+}
+
+//------------------------------------------------------------------------------
+float box_box_contact(motion const& motion_a, motion const& motion_b, vec3& point, vec3& direction, simplex_cache* /*cache*/)
+{
+    // reference edges on A are preferred unless B is better by this amount
+    constexpr float tolerance = 1e-3f;
+
+    shape_transform<box_shape> transform[2] = {motion_a, motion_b};
+    vec2 half_size[2] = {transform[0].get_shape()->half_size(), transform[1].get_shape()->half_size()};
+
+    // vertices of each box in world space and in the local space of the other box
+    vec2 vertices[2][5];
+    vec2 relative_vertices[2][4];
+    for (int ii = 0; ii < 2; ++ii) {
+        polygon_vertices polygon(transform[ii].get_shape());
+        for (std::size_t jj = 0; jj < 4; ++jj) {
+            vertices[ii][jj] = transform[ii].point_to_world(polygon[jj]);
+            relative_vertices[ii][jj] = transform[1 - ii].point_to_local(vertices[ii][jj]);
         }
+        vertices[ii][4] = vertices[ii][0];
     }
 
-    return min_index;
+    std::size_t edge_a = 0, edge_b = 0;
+    float separation_a = box_separation(half_size[0], relative_vertices[1], edge_a);
+    float separation_b = box_separation(half_size[1], relative_vertices[0], edge_b);
+
+    vec2 point_a, point_b;
+
+    if (separation_a > 0.f || separation_b > 0.f) {
+        // nearest points are between a vertex of one box and the other box
+        float distance_sqr = FLT_MAX;
+        for (int ii = 0; ii < 2; ++ii) {
+            for (std::size_t jj = 0; jj < 4; ++jj) {
+                vec2 v = relative_vertices[ii][jj];
+                vec2 p = vec2(std::max(-half_size[1 - ii].x, std::min(half_size[1 - ii].x, v.x)),
+                              std::max(-half_size[1 - ii].y, std::min(half_size[1 - ii].y, v.y)));
+                float d = (v - p).length_sqr();
+                if (d < distance_sqr) {
+                    distance_sqr = d;
+                    point_a = ii ? transform[0].point_to_world(p) : vertices[0][jj];
+                    point_b = ii ? vertices[1][jj] : transform[1].point_to_world(p);
+                }
+            }
+        }
+        vec2 normal = point_b - point_a;
+        float distance = normal.normalize_length();
+        point = vec3(point_a, 1);
+        direction = vec3(normal);
+        return distance;
+    } else if (separation_b > separation_a + tolerance) {
+        // incident points are on A
+        polygon_clip(vertices[1], edge_b, vertices[0], 4, point_a);
+        point = vec3(point_a, 1);
+        direction = -vec3((vertices[1][edge_b + 1] - vertices[1][edge_b]).cross(1.f).normalize());
+        return separation_b;
+    } else {
+        // incident points are on B, project them onto the reference edge
+        polygon_clip(vertices[0], edge_a, vertices[1], 4, point_b);
+        vec2 normal = (vertices[0][edge_a + 1] - vertices[0][edge_a]).cross(1.f).normalize();
+        point = vec3(point_b - normal * normal.dot(point_b - vertices[0][edge_a]), 1);
+        direction = vec3(normal);
+        return separation_a;
+    }
+}
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+collide::contact_func const collide::contact_table[num_shape_types][num_shape_types] = {
+    // box
+    {&box_box_contact, &convex_circle_contact, &gjk_contact, &gjk_contact},
+    // circle
+    {&circle_convex_contact, &circle_circle_contact, &circle_convex_contact, &gjk_contact},
+    // convex
+    {&gjk_contact, &convex_circle_contact, &gjk_contact, &gjk_contact},
+    // compound
+    {&gjk_contact, &gjk_contact, &gjk_contact, &gjk_contact},
+};
+
+//------------------------------------------------------------------------------
+collide::contact_func collide::generic_contact_function()
+{
+    return &gjk_contact;
+}
+
+//------------------------------------------------------------------------------
+bool collide::has_closed_form(shape_type type_a, shape_type type_b)
+{
+    contact_func fn = contact_function(type_a, type_b);
+    return fn == &circle_circle_contact
+        || fn == &circle_convex_contact
+        || fn == &convex_circle_contact
+        || fn == &box_box_contact;
+}
+
+//------------------------------------------------------------------------------
+vec2 collide::closest_point(shape const* shape, vec2 point)
+{
+    static circle_shape point_shape(0.f);
+    motion point_motion{&point_shape, point};
+
+    if (shape->type() == shape_type::compound) {
+        float best_distance = FLT_MAX;
+        vec2 best_point = vec2_zero;
+        for (auto& child : *static_cast<compound_shape const*>(shape)) {
+            motion shape_motion{
+                child.shape.get(),
+                child.position,
+                child.rotation
+            };
+            collide c(shape_motion, point_motion);
+            float distance = (c.get_contact().point - point).length_sqr();
+            if (distance < best_distance) {
+                best_distance = distance;
+                best_point = c.get_contact().point;
+            }
+        }
+        return best_point;
+    } else {
+        motion shape_motion{shape};
+        collide c(shape_motion, point_motion);
+        return c.get_contact().point;
+    }
+}
+
+//------------------------------------------------------------------------------
+collide::collide(motion const& motion_a, motion const& motion_b, simplex_cache* cache)
+    : collide(contact_function(motion_a.get_shape()->type(), motion_b.get_shape()->type()), motion_a, motion_b, cache)
+{}
+
+//------------------------------------------------------------------------------
+collide::collide(contact_func fn, motion const& motion_a, motion const& motion_b, simplex_cache* cache)
+{
+    vec3 position = vec3_zero;
+    vec3 direction = vec3(motion_b.get_position() - motion_a.get_position());
+
+    float distance = fn(motion_a, motion_b, position, direction, cache);
+
+    // Calculate the relative velocity of the bodies at the contact point
+    vec3 relative_velocity = vec3(motion_b.get_linear_velocity(position.to_vec2()))
+                           - vec3(motion_a.get_linear_velocity(position.to_vec2()));
+
+    if (distance < 0.0f && relative_velocity.dot(direction) < 0.f) {
+        _has_contact = true;
+    } else {
+        _has_contact = false;
+    }
+
+    _contact.distance = distance;
+    _contact.point = position.to_vec2();
+    _contact.normal = direction.to_vec2();
+    assert(!isnan(_contact.distance));
+    assert(!isnan(_contact.point));
+    assert(!isnan(_contact.normal));
 }
 
 } // namespace physics
@@ -5,12 +5,11 @@
 
 #include "cm_vector.h"
 #include "p_motion.h"
+#include "p_shape.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace physics {
 
-class shape;
-
 //------------------------------------------------------------------------------
 struct contact
 {
@@ -19,11 +18,64 @@ struct contact
     vec2 normal; //!< Contact normal in world space
 };
 
+//------------------------------------------------------------------------------
+//! Search directions of the last GJK simplex for a pair of convex shapes, used
+//! to warm start subsequent queries between the same pair of shapes.
+struct simplex_cache
+{
+    shape const* shape_a;
+    shape const* shape_b;
+    vec2 directions[2]; //!< Support directions in the local space of shape A
+};
+
+//------------------------------------------------------------------------------
+//! Persistent collision state for a pair of bodies, holds a simplex cache for
+//! each pair of convex child shapes that has been queried between the bodies.
+class pair_cache
+{
+public:
+    constexpr static std::size_t max_entries = 16;
+
+    pair_cache()
+        : _num_entries(0)
+    {}
+
+    //! Return the simplex cache for the given pair of shapes, or nullptr if
+    //! the cache is full. New entries are empty until written by `collide`.
+    simplex_cache* get(shape const* shape_a, shape const* shape_b) {
+        for (std::size_t ii = 0; ii < _num_entries; ++ii) {
+            if (_entries[ii].shape_a == shape_a && _entries[ii].shape_b == shape_b) {
+                return &_entries[ii];
+            }
+        }
+        if (_num_entries < max_entries) {
+            _entries[_num_entries] = {};
+            return &_entries[_num_entries++];
+        }
+        return nullptr;
+    }
+
+protected:
+    simplex_cache _entries[max_entries];
+    std::size_t _num_entries;
+};
+
 //------------------------------------------------------------------------------
 class collide
 {
 public:
-    collide(motion const& motion_a, motion const& motion_b);
+    //! Calculates the signed distance between A and B, writes the contact
+    //! point on A to `point` and the contact normal from A to B to `direction`.
+    //! `direction` initially holds the vector from the center of A to B.
+    using contact_func = float (*)(motion const& motion_a, motion const& motion_b, vec3& point, vec3& direction, simplex_cache* cache);
+
+    //! If `cache` is not null the query is warm started from the simplex in
+    //! `cache` and the final simplex is written back to `cache`.
+    collide(motion const& motion_a, motion const& motion_b, simplex_cache* cache = nullptr);
+
+    //! Same as above but uses `fn` instead of looking up the contact function
+    //! from the shape types of A and B, e.g. when the query is repeated.
+    collide(contact_func fn, motion const& motion_a, motion const& motion_b, simplex_cache* cache = nullptr);
 
     bool has_contact() const {
         return _has_contact;
@@ -35,55 +87,28 @@ public:
 
     static vec2 closest_point(shape const* shape, vec2 point);
 
-protected:
-    bool _has_contact;
-
-    contact _contact;
-
-    struct motion_data : motion
-    {
-        motion_data(motion const&);
-        mat3 local_to_world;
-        mat3 world_to_local;
-    };
-
-    constexpr static int max_iterations = 64;
-    constexpr static int max_vertices = 64;
-    constexpr static float epsilon = 1e-12f;
-
-    struct support_vertex
-    {
-        vec3 a; //!< point on object A
-        vec3 b; //!< point on object B
-        vec3 d; //!< "Minkowski difference"; a - b
-    };
-
-    //
-    //  GJK
-    //
-
-    float minimum_distance(vec3& point, vec3& direction) const;
-
-    support_vertex supporting_vertex(vec3 direction) const;
-
-    vec3 motion_supporting_vertex(motion_data const& motion, vec3 direction) const;
-
-    vec3 nearest_difference(support_vertex a, support_vertex b) const;
-
-    vec3 nearest_point(support_vertex a, support_vertex b) const;
+    //! Returns the contact function for a pair of shape types. Pairs of
+    //! circles and boxes and circle-convex pairs are calculated in closed
+    //! form, all other pairs use `generic_contact_function`.
+    static contact_func contact_function(shape_type type_a, shape_type type_b) {
+        return contact_table[std::size_t(type_a)][std::size_t(type_b)];
+    }
 
-    bool triangle_contains_origin(vec3 a, vec3 b, vec3 c) const;
+    //! Returns the GJK and EPA contact function which calls the virtual
+    //! `shape::supporting_vertex` and supports any pair of shape types.
+    static contact_func generic_contact_function();
 
-    //
-    //  EPA
-    //
+    //! Returns true if contact between the given shape types is calculated
+    //! in closed form instead of by GJK, i.e. without using a simplex cache.
+    static bool has_closed_form(shape_type type_a, shape_type type_b);
 
-    float penetration_distance(support_vertex a, support_vertex b, support_vertex c, vec3& point, vec3& direction) const;
+protected:
+    bool _has_contact;
 
-    std::size_t nearest_edge_index(vec3 normal, support_vertex const* vertices, std::size_t num_vertices, vec3& direction) const;
+    contact _contact;
 
-protected:
-    motion_data _motion[2];
+    //! Contact functions indexed by the shape types of A and B
+    static contact_func const contact_table[num_shape_types][num_shape_types];
 };
 
 } // namespace physics
@@ -8,63 +8,116 @@
 namespace physics {
 
 //------------------------------------------------------------------------------
-bool compound_shape::contains_point(vec2 point) const
+compound_shape::compound_shape(child_shape* children, std::size_t num_children)
 {
-    for (auto& child : _children) {
-        if (child.shape->contains_point(point * child.inverse_transform)) {
-            return true;
-        }
+    for (std::size_t ii = 0; ii < num_children; ++ii) {
+        add_child(std::move(children[ii]));
     }
-    return false;
-}
 
-//------------------------------------------------------------------------------
-vec2 compound_shape::supporting_vertex(vec2 /*direction*/) const
-{
-    assert(false);
-    return vec2_zero;
-}
+    assert(_children.size());
+    _local_bounds = _children[0].local_bounds;
+    for (std::size_t ii = 1, sz = _children.size(); ii < sz; ++ii) {
+        _local_bounds |= _children[ii].local_bounds;
+    }
 
-//------------------------------------------------------------------------------
-float compound_shape::calculate_area() const
-{
-    float area = 0.f;
+    _area = 0.f;
     // Assume subshapes are not overlapping
     for (auto const& child : _children) {
-        area += child.shape->calculate_area();
+        _area += child.shape->calculate_area();
     }
-    return area;
-}
 
-//------------------------------------------------------------------------------
-void compound_shape::calculate_mass_properties(float inverse_mass, vec2& center_of_mass, float& inverse_inertia) const
-{
-    center_of_mass = vec2_zero;
+    _center_of_mass = vec2_zero;
 
-    float inverse_area = 1.f / calculate_area();
+    float inverse_area = 1.f / _area;
     float inertia = 0.f;
 
     for (auto const& child : _children) {
         vec2 child_center_of_mass;
         float child_inverse_inertia;
 
-        float child_area = child.shape->calculate_area();
-        float child_mass = inverse_mass ? child_area * inverse_area / inverse_mass : 0.f;
+        float child_mass = child.shape->calculate_area() * inverse_area;
 
         child.shape->calculate_mass_properties(
-            inverse_mass,
+            1.f,
             child_center_of_mass,
             child_inverse_inertia);
 
-        center_of_mass += child_center_of_mass * child.transform * child_mass;
+        _center_of_mass += child_center_of_mass * child.transform * child_mass;
         // by parallel axis theorem: I = I0 + md^2
         if (child_inverse_inertia) {
             inertia += 1.f / child_inverse_inertia + child_mass * child.position.length_sqr();
         }
     }
 
-    center_of_mass *= inverse_mass;
-    inverse_inertia = inertia ? 1.f / inertia : 0.f;
+    _unit_inertia = inertia;
+}
+
+//------------------------------------------------------------------------------
+void compound_shape::add_child(child_shape&& child)
+{
+    if (child.shape->type() == shape_type::compound) {
+        mat3 transform = mat3::transform(child.position, child.rotation);
+        // the nested compound may be shared so its children are copied
+        for (auto grandchild : static_cast<compound_shape const*>(child.shape.get())->_children) {
+            grandchild.position = grandchild.position * transform;
+            grandchild.rotation += child.rotation;
+            add_child(std::move(grandchild));
+        }
+        return;
+    }
+
+    child.transform = mat3::transform(child.position, child.rotation);
+    child.inverse_transform = mat3::inverse_transform(child.position, child.rotation);
+    child.local_bounds = child.shape->calculate_bounds(child.transform);
+
+    // bounding circle of the child's bounds in its own space
+    bounds shape_bounds = child.shape->calculate_bounds(mat3::transform(vec2_zero, 0.f));
+    child.center = shape_bounds.center() * child.transform;
+    child.radius = shape_bounds.size().length() * .5f;
+
+    _children.push_back(std::move(child));
+}
+
+//------------------------------------------------------------------------------
+bool compound_shape::contains_point(vec2 point) const
+{
+    if (!_local_bounds.contains(point)) {
+        return false;
+    }
+    for (auto& child : _children) {
+        if (!child.local_bounds.contains(point)) {
+            continue;
+        }
+        if (child.shape->contains_point(point * child.inverse_transform)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+vec2 compound_shape::supporting_vertex(vec2 /*direction*/) const
+{
+    assert(false);
+    return vec2_zero;
+}
+
+//------------------------------------------------------------------------------
+float compound_shape::calculate_area() const
+{
+    return _area;
+}
+
+//------------------------------------------------------------------------------
+void compound_shape::calculate_mass_properties(float inverse_mass, vec2& center_of_mass, float& inverse_inertia) const
+{
+    if (inverse_mass) {
+        center_of_mass = _center_of_mass;
+        inverse_inertia = _unit_inertia ? inverse_mass / _unit_inertia : 0.f;
+    } else {
+        center_of_mass = vec2_zero;
+        inverse_inertia = 0.f;
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -16,21 +16,25 @@ class compound_shape : public shape
 {
 public:
     struct child_shape {
-        std::unique_ptr<physics::shape> shape;
+        //! Children are immutable and may be shared by any number of compounds
+        std::shared_ptr<physics::shape const> shape;
         vec2 position;
         float rotation;
         mat3 transform;
         mat3 inverse_transform;
+        bounds local_bounds; //!< bounds of the child in the space of the compound
+        vec2 center; //!< center of the bounding circle in the space of the compound
+        float radius; //!< radius of the bounding circle
     };
 
 public:
-    template<std::size_t size> compound_shape(child_shape (&&children)[size]) {
-        for (std::size_t ii = 0; ii < size; ++ii) {
-            _children.push_back(std::move(children[ii]));
-            _children.back().transform = mat3::transform(_children.back().position, _children.back().rotation);
-            _children.back().inverse_transform = mat3::inverse_transform(_children.back().position, _children.back().rotation);
-        }
-    }
+    //! Children which are themselves compound shapes are replaced by their
+    //! own children so that the hierarchy is never more than one level deep.
+    template<std::size_t size> compound_shape(child_shape (&&children)[size])
+        : compound_shape(children, size)
+    {}
+
+    compound_shape(child_shape* children, std::size_t num_children);
 
     virtual shape_type type() const override {
         return shape_type::compound;
@@ -50,8 +54,21 @@ public:
 
     child_shape const* end() const { return _children.data() + _children.size(); }
 
+    //! Bounds of all children in the space of the compound
+    bounds local_bounds() const { return _local_bounds; }
+
 protected:
     std::vector<child_shape> _children;
+
+    //! Mass properties are calculated once on construction, inertia is stored
+    //! for unit inverse mass and scaled by the inverse mass of the body.
+    float _area;
+    vec2 _center_of_mass;
+    float _unit_inertia;
+    bounds _local_bounds;
+
+protected:
+    void add_child(child_shape&& child);
 };
 
 } // namespace physics
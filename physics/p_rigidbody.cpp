@@ -3,61 +3,184 @@
 
 #include "p_rigidbody.h"
 #include "p_shape.h"
+#include "p_world.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace physics {
 
+//------------------------------------------------------------------------------
+rigid_body::rigid_body(rigid_body const& other)
+    : _motion(other.get_motion())
+    , _inverse_mass(other.get_inverse_mass())
+    , _inverse_inertia(other.get_inverse_inertia())
+    , _center_of_mass(other._center_of_mass)
+    , _material(other.get_material())
+    , _collision_filter(other.get_collision_filter())
+    , _world(nullptr)
+    , _store(nullptr)
+    , _index(0)
+    , _proxy(0)
+{}
+
+//------------------------------------------------------------------------------
+rigid_body& rigid_body::operator=(rigid_body const& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    if (_store) {
+        _store->set_state(_index,
+                          other.get_motion(),
+                          other.get_inverse_mass(),
+                          other.get_inverse_inertia(),
+                          other.get_material(),
+                          other.get_collision_filter());
+    } else {
+        _motion = other.get_motion();
+        _inverse_mass = other.get_inverse_mass();
+        _inverse_inertia = other.get_inverse_inertia();
+        _material = other.get_material();
+        _collision_filter = other.get_collision_filter();
+    }
+    _center_of_mass = other._center_of_mass;
+
+    if (_world) {
+        _world->update_body(this);
+        if (get_linear_velocity() != vec2_zero || get_angular_velocity() != 0.f) {
+            _world->wake_body(this);
+        }
+    }
+    return *this;
+}
+
+//------------------------------------------------------------------------------
+void rigid_body::set_position(vec2 position)
+{
+    if (_store) {
+        _store->set_position(_index, position);
+    } else {
+        _motion.set_position(position);
+    }
+
+    if (_world) {
+        _world->update_body(this);
+    }
+}
+
+//------------------------------------------------------------------------------
+void rigid_body::set_rotation(float rotation)
+{
+    if (_store) {
+        _store->set_rotation(_index, rotation);
+    } else {
+        _motion.set_rotation(rotation);
+    }
+
+    if (_world) {
+        _world->update_body(this);
+    }
+}
+
+//------------------------------------------------------------------------------
+void rigid_body::set_linear_velocity(vec2 linear_velocity)
+{
+    if (_store) {
+        _store->set_linear_velocity(_index, linear_velocity);
+    } else {
+        _motion.set_linear_velocity(linear_velocity);
+    }
+
+    if (_world && linear_velocity != vec2_zero) {
+        _world->wake_body(this);
+    }
+}
+
+//------------------------------------------------------------------------------
+void rigid_body::set_angular_velocity(float angular_velocity)
+{
+    if (_store) {
+        _store->set_angular_velocity(_index, angular_velocity);
+    } else {
+        _motion.set_angular_velocity(angular_velocity);
+    }
+
+    if (_world && angular_velocity != 0.f) {
+        _world->wake_body(this);
+    }
+}
+
 //------------------------------------------------------------------------------
 float rigid_body::get_kinetic_energy() const
 {
     float energy = 0.0f;
+    float inverse_mass = get_inverse_mass();
+    float inverse_inertia = get_inverse_inertia();
 
-    if (_inverse_mass) {
-        vec2 linear = _motion.get_linear_velocity();
-        energy += 0.5f * linear.dot(linear) / _inverse_mass;
+    if (inverse_mass) {
+        vec2 linear = get_linear_velocity();
+        energy += 0.5f * linear.dot(linear) / inverse_mass;
     }
-    if (_inverse_inertia) {
-        float angular = _motion.get_angular_velocity();
-        energy += 0.5f * angular * angular / _inverse_inertia;
+    if (inverse_inertia) {
+        float angular = get_angular_velocity();
+        energy += 0.5f * angular * angular / inverse_inertia;
     }
 
     return energy;
 }
 
+//------------------------------------------------------------------------------
+void rigid_body::wake()
+{
+    if (_world) {
+        _world->wake_body(this);
+    }
+}
+
 //------------------------------------------------------------------------------
 void rigid_body::apply_impulse(vec2 impulse)
 {
-    vec2 linear = _motion.get_linear_velocity();
-    linear += impulse * _inverse_mass;
-    _motion.set_linear_velocity(linear);
+    vec2 linear = get_linear_velocity();
+    linear += impulse * get_inverse_mass();
+    set_linear_velocity(linear);
 }
 
 //------------------------------------------------------------------------------
 void rigid_body::apply_impulse(vec2 impulse, vec2 position)
 {
-    vec2 linear = _motion.get_linear_velocity();
-    linear += impulse * _inverse_mass;
-    _motion.set_linear_velocity(linear);
-
-    float angular = _motion.get_angular_velocity();
-    vec2 displacement = position - _motion.get_position();
-    angular += displacement.cross(impulse) * _inverse_inertia;
-    _motion.set_angular_velocity(angular);
+    vec2 linear = get_linear_velocity();
+    linear += impulse * get_inverse_mass();
+    set_linear_velocity(linear);
+
+    float angular = get_angular_velocity();
+    vec2 displacement = position - get_position();
+    angular += displacement.cross(impulse) * get_inverse_inertia();
+    set_angular_velocity(angular);
 }
 
 //------------------------------------------------------------------------------
 void rigid_body::set_mass(float mass)
 {
-    if (mass && _inverse_mass) {
-        float ratio = mass * _inverse_mass;
-        _inverse_mass *= ratio;
-        _inverse_inertia *= ratio;
+    float inverse_mass = get_inverse_mass();
+    float inverse_inertia = get_inverse_inertia();
+
+    if (mass && inverse_mass) {
+        float ratio = mass * inverse_mass;
+        inverse_mass *= ratio;
+        inverse_inertia *= ratio;
     } else if (mass) {
-        _inverse_mass = 1.0f / mass;
-        _motion.get_shape()->calculate_mass_properties(_inverse_mass, _center_of_mass, _inverse_inertia);
+        inverse_mass = 1.0f / mass;
+        get_shape()->calculate_mass_properties(inverse_mass, _center_of_mass, inverse_inertia);
+    } else {
+        inverse_mass = 0.0f;
+        inverse_inertia = 0.0f;
+    }
+
+    if (_store) {
+        _store->set_inverse_mass(_index, inverse_mass, inverse_inertia);
     } else {
-        _inverse_mass = 0.0f;
-        _inverse_inertia = 0.0f;
+        _inverse_mass = inverse_mass;
+        _inverse_inertia = inverse_inertia;
     }
 }
 
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "p_bodystore.h"
 #include "p_motion.h"
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -10,8 +11,23 @@ namespace physics {
 
 class shape;
 class material;
+class world;
 
 //------------------------------------------------------------------------------
+/*
+    Rigid body handle
+
+    While a body is not part of a world its state is stored inline. When the
+    body is added to a world its state is moved into the world's body_store and
+    all accessors read and write the contiguous arrays instead, the state is
+    copied back when the body is removed. Shapes must not be modified while the
+    body is part of a world.
+
+    Bodies that come to rest in a world are put to sleep and are no longer
+    simulated until they are woken by a collision, an impulse or a non-zero
+    velocity. Moving a sleeping body with set_position or set_rotation does
+    not wake it.
+*/
 class rigid_body
 {
 public:
@@ -21,12 +37,22 @@ public:
         , _inverse_inertia(0)
         , _center_of_mass(0,0)
         , _material(material)
+        , _collision_filter(default_collision_filter)
+        , _world(nullptr)
+        , _store(nullptr)
+        , _index(0)
+        , _proxy(0)
     {
         set_mass(mass);
     }
 
-    motion const& get_motion() const {
-        return _motion;
+    //! Copies are not added to the world of the copied body
+    rigid_body(rigid_body const& other);
+    //! Assignment does not change which world this body belongs to
+    rigid_body& operator=(rigid_body const& other);
+
+    motion get_motion() const {
+        return _store ? _store->get_motion(_index) : _motion;
     }
 
     //
@@ -34,31 +60,27 @@ public:
     //
 
     vec2 get_position() const {
-        return _motion.get_position();
+        return _store ? _store->get_position(_index) : _motion.get_position();
     }
 
-    void set_position(vec2 position) {
-        _motion.set_position(position);
-    }
+    void set_position(vec2 position);
 
     float get_rotation() const {
-        return _motion.get_rotation();
+        return _store ? _store->get_rotation(_index) : _motion.get_rotation();
     }
 
-    void set_rotation(float rotation) {
-        _motion.set_rotation(rotation);
-    }
+    void set_rotation(float rotation);
 
     mat3 get_transform() const {
-        return _motion.get_transform();
+        return mat3::transform(get_position(), get_rotation());
     }
 
     mat3 get_inverse_transform() const {
-        return _motion.get_inverse_transform();
+        return mat3::inverse_transform(get_position(), get_rotation());
     }
 
     bounds get_bounds() const {
-        return _motion.get_bounds();
+        return _store ? _store->get_bounds(_index) : _motion.get_bounds();
     }
 
     //
@@ -66,24 +88,24 @@ public:
     //
 
     vec2 get_linear_velocity() const {
-        return _motion.get_linear_velocity();
+        return _store ? _store->get_linear_velocity(_index) : _motion.get_linear_velocity();
     }
 
     vec2 get_linear_velocity(vec2 position) const {
-        return _motion.get_linear_velocity(position);
+        // v = l + a x r
+        //   = l - r x a
+        return get_linear_velocity() - (position - get_position()).cross(get_angular_velocity());
     }
 
-    void set_linear_velocity(vec2 linear_velocity) {
-        _motion.set_linear_velocity(linear_velocity);
-    }
+    //! Wakes the body if `linear_velocity` is non-zero
+    void set_linear_velocity(vec2 linear_velocity);
 
     float get_angular_velocity() const {
-        return _motion.get_angular_velocity();
+        return _store ? _store->get_angular_velocity(_index) : _motion.get_angular_velocity();
     }
 
-    void set_angular_velocity(float angular_velocity) {
-        _motion.set_angular_velocity(angular_velocity);
-    }
+    //! Wakes the body if `angular_velocity` is non-zero
+    void set_angular_velocity(float angular_velocity);
 
     float get_kinetic_energy() const;
 
@@ -91,6 +113,15 @@ public:
     //  dynamics
     //
 
+    //! Bodies which are not part of a world are always awake
+    bool is_awake() const {
+        return _store ? _store->is_awake(_index) : true;
+    }
+
+    //! Return a sleeping body to the world's set of simulated bodies
+    void wake();
+
+    //! Wakes the body if the resulting velocity is non-zero
     void apply_impulse(vec2 impulse);
 
     void apply_impulse(vec2 impulse, vec2 position);
@@ -100,28 +131,42 @@ public:
     //
 
     float get_mass() const {
-        return _inverse_mass ? 1.0f / _inverse_mass : 0.0f;
+        float inverse_mass = get_inverse_mass();
+        return inverse_mass ? 1.0f / inverse_mass : 0.0f;
     }
 
     void set_mass(float mass);
 
     float get_inverse_mass() const {
-        return _inverse_mass;
+        return _store ? _store->get_inverse_mass(_index) : _inverse_mass;
     }
 
     float get_inverse_inertia() const {
-        return _inverse_inertia;
+        return _store ? _store->get_inverse_inertia(_index) : _inverse_inertia;
     }
 
     shape const* get_shape() const {
-        return _motion.get_shape();
+        return _store ? _store->get_shape(_index) : _motion.get_shape();
     }
 
     material const* get_material() const {
-        return _material;
+        return _store ? _store->get_material(_index) : _material;
+    }
+
+    collision_filter const& get_collision_filter() const {
+        return _store ? _store->get_collision_filter(_index) : _collision_filter;
+    }
+
+    void set_collision_filter(collision_filter const& filter) {
+        if (_store) {
+            _store->set_collision_filter(_index, filter);
+        } else {
+            _collision_filter = filter;
+        }
     }
 
 protected:
+    //! Inline state, only valid while the body is not part of a world
     motion _motion;
 
     float _inverse_mass;
@@ -129,6 +174,17 @@ protected:
     vec2 _center_of_mass;
 
     material const* _material;
+    collision_filter _collision_filter;
+
+    friend world;
+    //! World that this body has been added to, notified when the body moves
+    world* _world;
+    //! Storage for the state of this body while it is part of a world
+    body_store* _store;
+    //! Index of this body in `_store`
+    std::size_t _index;
+    //! Proxy id of this body in the world's bounding volume tree
+    std::size_t _proxy;
 };
 
 } // namespace physics
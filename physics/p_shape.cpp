@@ -7,6 +7,22 @@
 ////////////////////////////////////////////////////////////////////////////////
 namespace physics {
 
+namespace {
+
+//------------------------------------------------------------------------------
+//! Returns a value in [0, 4) which increases monotonically with the angle of
+//! `v` measured counter-clockwise from the positive x-axis, like atan2 but
+//! without trigonometric functions.
+float pseudo_angle(vec2 v)
+{
+    float x = std::abs(v.x);
+    float y = std::abs(v.y);
+    float p = v.y / (x + y);
+    return v.x < 0.f ? 2.f - p : (v.y < 0.f ? 4.f + p : p);
+}
+
+} // anonymous namespace
+
 //------------------------------------------------------------------------------
 convex_shape::convex_shape()
     : convex_shape({{1,0},{0,1},{-1,0},{0,-1}})
@@ -33,13 +49,16 @@ convex_shape::convex_shape(vec2 const* vertices, std::size_t num_vertices)
         _num_vertices = _decimate_convex_hull(decimated, num_decimated, kMaxVertices);
 
         // copy to vertices
-        std::copy(decimated, decimated + _num_vertices + 1, _vertices);
+        _vertices.assign(decimated, decimated + _num_vertices + 1);
     } else {
-        // copy to vertices
-        std::copy(vertices, vertices + num_vertices, _vertices);
+        // copy to vertices, including space for the repeated first vertex
+        _vertices.resize(std::max<std::size_t>(num_vertices, 3) + 1);
+        std::copy(vertices, vertices + num_vertices, _vertices.data());
 
         // extract convex hull in-place
-        _num_vertices = _extract_convex_hull(_vertices, num_vertices);
+        _num_vertices = _extract_convex_hull(_vertices.data(), num_vertices);
+        _vertices.resize(_num_vertices + 1);
+        _vertices.shrink_to_fit();
     }
 
     // calculate center of mass and area
@@ -49,34 +68,64 @@ convex_shape::convex_shape(vec2 const* vertices, std::size_t num_vertices)
         _area += area;
     }
     _center_of_mass /= 3.f * _area;
+
+    _calculate_normals();
 }
 
 //------------------------------------------------------------------------------
-bool convex_shape::contains_point(vec2 point) const
+void convex_shape::_calculate_normals()
 {
+    _normals.resize(_num_vertices);
+    _normal_angles.resize(_num_vertices);
+    _min_normal_index = 0;
     for (std::size_t ii = 0; ii < _num_vertices; ++ii) {
-        vec2 va = point - _vertices[ii];
-        vec2 vb = point - _vertices[ii + 1];
-        if (va.cross(vb) < 0.f) {
-            return false;
+        _normals[ii] = (_vertices[ii + 1] - _vertices[ii]).cross(1.f).normalize();
+        _normal_angles[ii] = pseudo_angle(_normals[ii]);
+        if (_normal_angles[ii] < _normal_angles[_min_normal_index]) {
+            _min_normal_index = ii;
         }
     }
-    return true;
 }
 
 //------------------------------------------------------------------------------
-vec2 convex_shape::supporting_vertex(vec2 direction) const
+std::size_t convex_shape::_search_supporting_vertex(vec2 direction) const
 {
-    std::size_t imax = 0;
-    float dmax = direction.dot(_vertices[0] - _center_of_mass);
-    for (std::size_t ii = 1; ii < _num_vertices; ++ii) {
-        float d = direction.dot(_vertices[ii] - _center_of_mass);
-        if (d > dmax) {
-            imax = ii;
-            dmax = d;
+    // edge normals of a convex polygon are sorted by angle starting from the
+    // normal with the smallest angle, vertex `ii` is the support for all
+    // directions between the normals of edge `ii - 1` and edge `ii`.
+    float angle = pseudo_angle(direction);
+
+    // find the first edge with a normal angle not less than `angle`
+    std::size_t lower = 0;
+    std::size_t upper = _num_vertices;
+    while (lower < upper) {
+        std::size_t middle = (lower + upper) / 2;
+        std::size_t index = _min_normal_index + middle;
+        if (index >= _num_vertices) {
+            index -= _num_vertices;
+        }
+        if (_normal_angles[index] < angle) {
+            lower = middle + 1;
+        } else {
+            upper = middle;
         }
     }
-    return _vertices[imax];
+
+    std::size_t index = _min_normal_index + lower;
+    return index >= _num_vertices ? index - _num_vertices : index;
+}
+
+//------------------------------------------------------------------------------
+bool convex_shape::contains_point(vec2 point) const
+{
+    for (std::size_t ii = 0; ii < _num_vertices; ++ii) {
+        vec2 va = point - _vertices[ii];
+        vec2 vb = point - _vertices[ii + 1];
+        if (va.cross(vb) < 0.f) {
+            return false;
+        }
+    }
+    return true;
 }
 
 //------------------------------------------------------------------------------
@@ -253,8 +302,34 @@ convex_shape convex_shape::expand_by_radius(float radius) const
         out._area += cross;
     }
     out._center_of_mass /= 3.f * out._area;
+    out._calculate_normals();
 
     return out;
 }
 
+//------------------------------------------------------------------------------
+polygon_vertices::polygon_vertices(shape const* shape)
+{
+    if (shape->type() == shape_type::box) {
+        vec2 half_size = static_cast<box_shape const*>(shape)->half_size();
+        _box_vertices[0] = vec2(-half_size.x, -half_size.y);
+        _box_vertices[1] = vec2(+half_size.x, -half_size.y);
+        _box_vertices[2] = vec2(+half_size.x, +half_size.y);
+        _box_vertices[3] = vec2(-half_size.x, +half_size.y);
+        _box_vertices[4] = _box_vertices[0];
+        _box_normals[0] = vec2(0, -1);
+        _box_normals[1] = vec2(1, 0);
+        _box_normals[2] = vec2(0, 1);
+        _box_normals[3] = vec2(-1, 0);
+        _vertices = _box_vertices;
+        _normals = _box_normals;
+        _num_vertices = 4;
+    } else {
+        assert(shape->type() == shape_type::convex);
+        _vertices = static_cast<convex_shape const*>(shape)->vertices();
+        _normals = static_cast<convex_shape const*>(shape)->normals();
+        _num_vertices = static_cast<convex_shape const*>(shape)->num_vertices();
+    }
+}
+
 } // namespace physics
@@ -8,6 +8,8 @@
 #include "cm_matrix.h"
 #include "cm_shared.h"
 
+#include <vector>
+
 ////////////////////////////////////////////////////////////////////////////////
 namespace physics {
 
@@ -19,6 +21,8 @@ enum class shape_type
     compound,
 };
 
+constexpr std::size_t num_shape_types = 4;
+
 //------------------------------------------------------------------------------
 class shape
 {
@@ -39,7 +43,7 @@ public:
 };
 
 //------------------------------------------------------------------------------
-class box_shape : public shape
+class box_shape final : public shape
 {
 public:
     box_shape(vec2 size)
@@ -61,6 +65,8 @@ public:
                                         direction.y < 0.f ? -1.f : 1.f);
     }
 
+    vec2 half_size() const { return _half_size; }
+
     virtual float calculate_area() const override {
         return 4.f * _half_size.x * _half_size.y;
     }
@@ -87,7 +93,7 @@ protected:
 };
 
 //------------------------------------------------------------------------------
-class circle_shape : public shape
+class circle_shape final : public shape
 {
 public:
     circle_shape(float radius)
@@ -107,6 +113,8 @@ public:
         return direction.normalize() * _radius;
     }
 
+    float radius() const { return _radius; }
+
     virtual float calculate_area() const override {
         return math::pi<float> * _radius * _radius;
     }
@@ -129,7 +137,7 @@ protected:
 };
 
 //------------------------------------------------------------------------------
-class convex_shape : public shape
+class convex_shape final : public shape
 {
 public:
     convex_shape();
@@ -146,7 +154,21 @@ public:
 
     virtual bool contains_point(vec2 point) const override;
 
-    virtual vec2 supporting_vertex(vec2 direction) const override;
+    virtual vec2 supporting_vertex(vec2 direction) const override {
+        if (_num_vertices > kMaxLinearSearch) {
+            return _vertices[_search_supporting_vertex(direction)];
+        }
+        std::size_t imax = 0;
+        float dmax = direction.dot(_vertices[0] - _center_of_mass);
+        for (std::size_t ii = 1; ii < _num_vertices; ++ii) {
+            float d = direction.dot(_vertices[ii] - _center_of_mass);
+            if (d > dmax) {
+                imax = ii;
+                dmax = d;
+            }
+        }
+        return _vertices[imax];
+    }
 
     virtual float calculate_area() const override { return _area; }
 
@@ -158,18 +180,63 @@ public:
 
     convex_shape expand_by_radius(float radius) const;
 
+    std::size_t num_vertices() const { return _num_vertices; }
+
+    //! Vertices in counter-clockwise order, the first vertex is repeated at
+    //! index `num_vertices()` so that edges can be iterated without wrapping.
+    vec2 const* vertices() const { return _vertices.data(); }
+
+    //! Outward unit normals of each edge, the edge at index `ii` is between
+    //! vertices `ii` and `ii + 1`.
+    vec2 const* normals() const { return _normals.data(); }
+
     static convex_shape from_planes(vec3 const* planes, std::size_t num_planes);
 
 protected:
     static constexpr std::size_t kMaxVertices = 64;
+    //! Shapes with more vertices than this use binary search for support queries
+    static constexpr std::size_t kMaxLinearSearch = 16;
     std::size_t _num_vertices;
     float _area;
     vec2 _center_of_mass;
-    vec2 _vertices[kMaxVertices + 1];
+    //! Storage is sized to the number of vertices after hull extraction
+    std::vector<vec2> _vertices;
+    std::vector<vec2> _normals;
+    //! Pseudo-angle of each edge normal, increasing from `_min_normal_index`
+    std::vector<float> _normal_angles;
+    std::size_t _min_normal_index;
 
 protected:
+    void _calculate_normals();
+    std::size_t _search_supporting_vertex(vec2 direction) const;
     std::size_t _extract_convex_hull(vec2* vertices, std::size_t num_vertices) const;
     std::size_t _decimate_convex_hull(vec2* vertices, std::size_t num_vertices, std::size_t max_vertices) const;
 };
 
+//------------------------------------------------------------------------------
+//! Local space vertices of a box or convex shape in counter-clockwise order,
+//! the first vertex is repeated at index `size()`.
+class polygon_vertices
+{
+public:
+    explicit polygon_vertices(shape const* shape);
+
+    polygon_vertices(polygon_vertices const&) = delete;
+    polygon_vertices& operator=(polygon_vertices const&) = delete;
+
+    std::size_t size() const { return _num_vertices; }
+
+    vec2 operator[](std::size_t index) const { return _vertices[index]; }
+
+    //! Outward unit normal of the edge between vertices `index` and `index + 1`
+    vec2 normal(std::size_t index) const { return _normals[index]; }
+
+protected:
+    vec2 const* _vertices;
+    vec2 const* _normals;
+    std::size_t _num_vertices;
+    vec2 _box_vertices[5];
+    vec2 _box_normals[4];
+};
+
 } // namespace physics
@@ -0,0 +1,107 @@
+// p_shapelibrary.cpp
+//
+
+#include "p_shapelibrary.h"
+
+////////////////////////////////////////////////////////////////////////////////
+namespace physics {
+
+//------------------------------------------------------------------------------
+std::shared_ptr<box_shape const> shape_library::box(vec2 size)
+{
+    return find_or_create<box_shape>(make_key("box", &size, sizeof(size)), [size]() {
+        return std::make_shared<box_shape const>(size);
+    });
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<circle_shape const> shape_library::circle(float radius)
+{
+    return find_or_create<circle_shape>(make_key("circle", &radius, sizeof(radius)), [radius]() {
+        return std::make_shared<circle_shape const>(radius);
+    });
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<convex_shape const> shape_library::convex(vec2 const* vertices, std::size_t num_vertices)
+{
+    std::string key = make_key("convex", vertices, sizeof(vec2) * num_vertices);
+    return find_or_create<convex_shape>(key, [vertices, num_vertices]() {
+        return std::make_shared<convex_shape const>(vertices, num_vertices);
+    });
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<compound_shape const> shape_library::compound(compound_shape::child_shape* children, std::size_t num_children)
+{
+    // children are identified by address, which is unique for as long as the
+    // compound is cached since the compound holds a reference to each child
+    std::string key = make_key("compound", nullptr, 0);
+    for (std::size_t ii = 0; ii < num_children; ++ii) {
+        physics::shape const* shape = children[ii].shape.get();
+        key.append(reinterpret_cast<char const*>(&shape), sizeof(shape));
+        key.append(reinterpret_cast<char const*>(&children[ii].position), sizeof(vec2));
+        key.append(reinterpret_cast<char const*>(&children[ii].rotation), sizeof(float));
+    }
+    return find_or_create<compound_shape>(key, [children, num_children]() {
+        return std::make_shared<compound_shape const>(children, num_children);
+    });
+}
+
+//------------------------------------------------------------------------------
+std::string shape_library::make_key(char const* tag, void const* data, std::size_t size)
+{
+    std::string key(tag);
+    key.push_back('\0');
+    key.append(static_cast<char const*>(data), size);
+    return key;
+}
+
+//------------------------------------------------------------------------------
+std::size_t shape_library::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::size_t count = 0;
+    for (auto const& entry : _entries) {
+        if (!entry.second.expired()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<void const> shape_library::find(std::string const& key) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _entries.find(key);
+    return it != _entries.end() ? it->second.lock() : nullptr;
+}
+
+//------------------------------------------------------------------------------
+std::shared_ptr<void const> shape_library::insert(std::string const& key, std::shared_ptr<void const> const& value)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto& entry = _entries[key];
+    if (auto existing = entry.lock()) {
+        return existing;
+    }
+    entry = value;
+
+    // amortize removal of entries whose shapes have been released
+    if (_entries.size() >= _purge_size) {
+        for (auto it = _entries.begin(); it != _entries.end();) {
+            if (it->second.expired()) {
+                it = _entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        _purge_size = std::max<std::size_t>(16, _entries.size() * 2);
+    }
+
+    return value;
+}
+
+} // namespace physics
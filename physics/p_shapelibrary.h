@@ -0,0 +1,81 @@
+// p_shapelibrary.h
+//
+
+#pragma once
+
+#include "p_compound.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace physics {
+
+//------------------------------------------------------------------------------
+/*
+    Cache of immutable, reference-counted shapes keyed by their definition
+
+    Requesting a shape with the same definition as a shape that is still
+    referenced returns the existing instance, so that every body built from
+    the same definition shares one shape along with its precomputed mass
+    properties and bounds. Entries are released with their last reference.
+    Compound definitions are keyed by the identity of their children, which
+    should themselves come from the library. Other immutable data derived from
+    shapes can be cached with `find_or_create` under a caller-provided key.
+    All methods are thread-safe.
+*/
+class shape_library
+{
+public:
+    std::shared_ptr<box_shape const> box(vec2 size);
+
+    std::shared_ptr<circle_shape const> circle(float radius);
+
+    std::shared_ptr<convex_shape const> convex(vec2 const* vertices, std::size_t num_vertices);
+    template<std::size_t sz> std::shared_ptr<convex_shape const> convex(vec2 const (&vertices)[sz]) {
+        return convex(vertices, sz);
+    }
+
+    template<std::size_t sz> std::shared_ptr<compound_shape const> compound(compound_shape::child_shape (&&children)[sz]) {
+        return compound(children, sz);
+    }
+
+    //! Return the object cached under `key` or cache the result of `create()`,
+    //! which must return a `std::shared_ptr<T const>`. Keys must be unique
+    //! across types, see `make_key`.
+    template<typename T, typename Fn> std::shared_ptr<T const> find_or_create(std::string const& key, Fn&& create);
+
+    //! Return a key from a type tag followed by the bytes of `data`
+    static std::string make_key(char const* tag, void const* data, std::size_t size);
+
+    //! Number of cached entries which are still referenced
+    std::size_t size() const;
+
+protected:
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, std::weak_ptr<void const>> _entries;
+    //! Expired entries are purged when the number of entries reaches this size
+    std::size_t _purge_size = 16;
+
+protected:
+    std::shared_ptr<compound_shape const> compound(compound_shape::child_shape* children, std::size_t num_children);
+
+    std::shared_ptr<void const> find(std::string const& key) const;
+    std::shared_ptr<void const> insert(std::string const& key, std::shared_ptr<void const> const& value);
+};
+
+//------------------------------------------------------------------------------
+template<typename T, typename Fn> std::shared_ptr<T const> shape_library::find_or_create(std::string const& key, Fn&& create)
+{
+    if (auto existing = find(key)) {
+        return std::static_pointer_cast<T const>(existing);
+    }
+    // construct without holding the lock, if another thread inserted the
+    // same key in the meantime then its instance is returned instead
+    std::shared_ptr<T const> value = create();
+    return std::static_pointer_cast<T const>(insert(key, value));
+}
+
+} // namespace physics
@@ -10,70 +10,90 @@
 ////////////////////////////////////////////////////////////////////////////////
 namespace physics {
 
+namespace {
+
+//------------------------------------------------------------------------------
+bounds swept_bounds(motion const& motion, float delta_time)
+{
+    // todo: include rotation
+    return bounds::from_translation(motion.get_bounds(), motion.get_linear_velocity() * delta_time);
+}
+
+//------------------------------------------------------------------------------
+//! Bounds swept by the bounding circle of a child of the compound shape in
+//! `motion` over `delta_time`, where `transform` is the transform of `motion`.
+bounds child_swept_bounds(compound_shape::child_shape const& child, motion const& motion, mat3 const& transform, float delta_time)
+{
+    // children are traced with the linear velocity of the compound and rotate
+    // about their own origin, which moves the center of the bounding circle by
+    // at most its distance from the origin times the angle of rotation.
+    float rotation = std::abs(motion.get_angular_velocity() * delta_time);
+    float radius = child.radius + (child.center - child.position).length() * rotation;
+    vec2 center = child.center * transform;
+    return bounds::from_translation(bounds(center - vec2(radius), center + vec2(radius)),
+                                    motion.get_linear_velocity() * delta_time);
+}
+
+} // anonymous namespace
+
 //------------------------------------------------------------------------------
 trace::trace(rigid_body const* body, vec2 start, vec2 end)
+    : trace(body->get_shape(), body->get_position(), body->get_rotation(), start, end)
+{}
+
+//------------------------------------------------------------------------------
+trace::trace(shape const* shape, vec2 position, float rotation, vec2 start, vec2 end)
 {
+    // segments are traced as a point with zero radius, which is immutable and
+    // shared by all segment traces
+    static physics::circle_shape const point_shape(0);
+
     physics::motion body_motion{
-        body->get_shape(),
-        body->get_position(),
-        body->get_rotation()
+        shape,
+        position,
+        rotation
     };
 
-    physics::circle_shape shape(0);
     physics::motion point_motion{
-        &shape,
+        &point_shape,
         start,
         0,
         end - start
     };
 
-    _fraction = dispatch(_contact, body_motion, point_motion, 1.f);
+    _num_iterations = 0;
+    _fraction = dispatch(_contact, body_motion, point_motion, 1.f, nullptr, _num_iterations);
 }
 
 //------------------------------------------------------------------------------
-trace::trace(rigid_body const* body_a, rigid_body const* body_b, float delta_time)
+trace::trace(rigid_body const* body_a, rigid_body const* body_b, float delta_time, pair_cache* cache)
 {
-    _fraction = dispatch(_contact, body_a->get_motion(), body_b->get_motion(), delta_time);
+    _num_iterations = 0;
+    _fraction = dispatch(_contact, body_a->get_motion(), body_b->get_motion(), delta_time, cache, _num_iterations);
 }
 
 //------------------------------------------------------------------------------
-float trace::dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time)
-{
-    auto fn = &convex_convex_dispatch;
-
-    switch (motion_a.get_shape()->type()) {
-        case shape_type::compound: {
-            switch (motion_b.get_shape()->type()) {
-                case shape_type::compound:
-                    fn = &compound_compound_dispatch;
-                    break;
-
-                default:
-                    fn = &compound_convex_dispatch;
-                    break;
-            }
-            break;
-        }
-
-        default: {
-            switch (motion_b.get_shape()->type()) {
-                case shape_type::compound:
-                    fn = &convex_compound_dispatch;
-                    break;
-
-                default:
-                    fn = &convex_convex_dispatch;
-                    break;
-            }
-            break;
-        }
-    }
+trace::dispatch_func const trace::dispatch_table[num_shape_types][num_shape_types] = {
+    // box
+    {&convex_convex_dispatch, &convex_circle_dispatch, &convex_convex_dispatch, &convex_compound_dispatch},
+    // circle
+    {&circle_convex_dispatch, &circle_circle_dispatch, &circle_convex_dispatch, &convex_compound_dispatch},
+    // convex
+    {&convex_convex_dispatch, &convex_circle_dispatch, &convex_convex_dispatch, &convex_compound_dispatch},
+    // compound
+    {&compound_convex_dispatch, &compound_convex_dispatch, &compound_convex_dispatch, &compound_compound_dispatch},
+};
 
-    return fn(contact, motion_a, motion_b, delta_time);
+//------------------------------------------------------------------------------
+float trace::dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations)
+{
+    dispatch_func fn = dispatch_table[std::size_t(motion_a.get_shape()->type())]
+                                     [std::size_t(motion_b.get_shape()->type())];
+    return fn(contact, motion_a, motion_b, delta_time, cache, num_iterations);
 }
 
 //------------------------------------------------------------------------------
-float trace::compound_compound_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time)
+float trace::compound_compound_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations)
 {
     assert(motion_a.get_shape()->type() == shape_type::compound);
     assert(motion_b.get_shape()->type() == shape_type::compound);
@@ -82,8 +102,14 @@ float trace::compound_compound_dispatch(contact& contact, motion motion_a, motio
     float f, fraction = 1.f;
 
     mat3 transform = motion_b.get_transform();
+    bounds other_bounds = swept_bounds(motion_a, delta_time);
 
     for (auto& child : *static_cast<compound_shape const*>(motion_b.get_shape())) {
+        // skip children which cannot touch the other body during this step
+        if (!child_swept_bounds(child, motion_b, transform, delta_time).intersects(other_bounds)) {
+            continue;
+        }
+
         motion child_motion{
             child.shape.get(),
             child.position * transform,
@@ -91,11 +117,7 @@ float trace::compound_compound_dispatch(contact& contact, motion motion_a, motio
             motion_b.get_linear_velocity(),
             motion_b.get_angular_velocity()};
 
-        if (child_motion.get_shape()->type() == shape_type::compound) {
-            f = compound_compound_dispatch(c, motion_a, child_motion, delta_time);
-        } else {
-            f = compound_convex_dispatch(c, motion_a, child_motion, delta_time);
-        }
+        f = dispatch(c, motion_a, child_motion, delta_time, cache, num_iterations);
 
         if (f < fraction) {
             contact = c;
@@ -107,7 +129,7 @@ float trace::compound_compound_dispatch(contact& contact, motion motion_a, motio
 }
 
 //------------------------------------------------------------------------------
-float trace::compound_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time)
+float trace::compound_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations)
 {
     assert(motion_a.get_shape()->type() == shape_type::compound);
     assert(motion_b.get_shape()->type() != shape_type::compound);
@@ -116,8 +138,14 @@ float trace::compound_convex_dispatch(contact& contact, motion motion_a, motion
     float f, fraction = 1.f;
 
     mat3 transform = motion_a.get_transform();
+    bounds other_bounds = swept_bounds(motion_b, delta_time);
 
     for (auto& child : *static_cast<compound_shape const*>(motion_a.get_shape())) {
+        // skip children which cannot touch the other body during this step
+        if (!child_swept_bounds(child, motion_a, transform, delta_time).intersects(other_bounds)) {
+            continue;
+        }
+
         motion child_motion{
             child.shape.get(),
             child.position * transform,
@@ -125,11 +153,7 @@ float trace::compound_convex_dispatch(contact& contact, motion motion_a, motion
             motion_a.get_linear_velocity(),
             motion_a.get_angular_velocity()};
 
-        if (child_motion.get_shape()->type() == shape_type::compound) {
-            f = convex_compound_dispatch(c, child_motion, motion_b, delta_time);
-        } else {
-            f = convex_convex_dispatch(c, child_motion, motion_b, delta_time);
-        }
+        f = dispatch(c, child_motion, motion_b, delta_time, cache, num_iterations);
 
         if (f < fraction) {
             contact = c;
@@ -141,19 +165,19 @@ float trace::compound_convex_dispatch(contact& contact, motion motion_a, motion
 }
 
 //------------------------------------------------------------------------------
-float trace::convex_compound_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time)
+float trace::convex_compound_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations)
 {
     assert(motion_a.get_shape()->type() != shape_type::compound);
     assert(motion_b.get_shape()->type() == shape_type::compound);
 
-    float fraction = compound_convex_dispatch(contact, motion_b, motion_a, delta_time);
+    float fraction = compound_convex_dispatch(contact, motion_b, motion_a, delta_time, cache, num_iterations);
     contact.point += contact.normal * contact.distance;
     contact.normal *= -1.f;
     return fraction;
 }
 
 //------------------------------------------------------------------------------
-float trace::convex_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time)
+float trace::convex_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations)
 {
     assert(motion_a.get_shape()->type() != shape_type::compound);
     assert(motion_b.get_shape()->type() != shape_type::compound);
@@ -168,9 +192,8 @@ float trace::convex_convex_dispatch(contact& contact, motion motion_a, motion mo
     float dr_a = motion_a.get_angular_velocity() * delta_time;
     float dr_b = motion_b.get_angular_velocity() * delta_time;
 
-    // todo: include rotation
-    bounds bounds_a = bounds::from_translation(motion_a.get_bounds(), dp_a);
-    bounds bounds_b = bounds::from_translation(motion_b.get_bounds(), dp_b);
+    bounds bounds_a = swept_bounds(motion_a, delta_time);
+    bounds bounds_b = swept_bounds(motion_b, delta_time);
 
     // bodies do not overlap during this time step
     if (!bounds_a.intersects(bounds_b)) {
@@ -184,13 +207,25 @@ float trace::convex_convex_dispatch(contact& contact, motion motion_a, motion mo
         return 1.0f;
     }
 
-    for (int num_iterations = 0; num_iterations < max_iterations && fraction < 1.0f; ++num_iterations) {
+    shape_type type_a = motion_a.get_shape()->type();
+    shape_type type_b = motion_b.get_shape()->type();
+
+    // look up the contact function once instead of on every iteration
+    collide::contact_func fn = collide::contact_function(type_a, type_b);
+
+    simplex_cache* simplex = nullptr;
+    if (cache && !collide::has_closed_form(type_a, type_b)) {
+        simplex = cache->get(motion_a.get_shape(), motion_b.get_shape());
+    }
+
+    for (int iteration = 0; iteration < max_iterations && fraction < 1.0f; ++iteration) {
         motion_a.set_position(p0_a + dp_a * fraction);
         motion_a.set_rotation(r0_a + dr_a * fraction);
         motion_b.set_position(p0_b + dp_b * fraction);
         motion_b.set_rotation(r0_b + dr_b * fraction);
 
-        contact = physics::collide(motion_a, motion_b).get_contact();
+        contact = physics::collide(fn, motion_a, motion_b, simplex).get_contact();
+        ++num_iterations;
 
         direction = motion_b.get_linear_velocity(contact.point)
                   - motion_a.get_linear_velocity(contact.point);
@@ -211,4 +246,242 @@ float trace::convex_convex_dispatch(contact& contact, motion motion_a, motion mo
     return fraction > 1.0f ? 1.0f : fraction;
 }
 
+//------------------------------------------------------------------------------
+float trace::circle_circle_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* /*cache*/, int& num_iterations)
+{
+    assert(motion_a.get_shape()->type() == shape_type::circle);
+    assert(motion_b.get_shape()->type() == shape_type::circle);
+
+    float radius = static_cast<circle_shape const*>(motion_a.get_shape())->radius()
+                 + static_cast<circle_shape const*>(motion_b.get_shape())->radius();
+
+    // rotation does not affect the contact between circles so the time of
+    // impact is the solution of |p + v * t| = radius in relative space
+    vec2 dp_a = motion_a.get_linear_velocity() * delta_time;
+    vec2 dp_b = motion_b.get_linear_velocity() * delta_time;
+    vec2 p = motion_b.get_position() - motion_a.get_position();
+    vec2 v = dp_b - dp_a;
+
+    float a = v.dot(v);
+    float b = p.dot(v);
+    float c = p.dot(p) - radius * radius;
+
+    // bodies are separating or not moving relative to each other
+    if (b >= 0.f) {
+        return 1.f;
+    }
+
+    // bodies are not initially touching
+    float fraction = 0.f;
+    if (c > 0.f) {
+        float discriminant = b * b - a * c;
+        if (discriminant < 0.f) {
+            return 1.f;
+        }
+        fraction = (-b - std::sqrt(discriminant)) / a;
+        if (fraction >= 1.f) {
+            return 1.f;
+        }
+    }
+
+    motion_a.set_position(motion_a.get_position() + dp_a * fraction);
+    motion_b.set_position(motion_b.get_position() + dp_b * fraction);
+    contact = physics::collide(motion_a, motion_b).get_contact();
+    ++num_iterations;
+    return fraction;
+}
+
+//------------------------------------------------------------------------------
+float trace::circle_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations)
+{
+    assert(motion_a.get_shape()->type() == shape_type::circle);
+
+    float fraction = convex_circle_dispatch(contact, motion_b, motion_a, delta_time, cache, num_iterations);
+    if (fraction < 1.f) {
+        contact.point += contact.normal * contact.distance;
+        contact.normal *= -1.f;
+    }
+    return fraction;
+}
+
+//------------------------------------------------------------------------------
+float trace::convex_circle_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* /*cache*/, int& num_iterations)
+{
+    assert(motion_a.get_shape()->type() == shape_type::box || motion_a.get_shape()->type() == shape_type::convex);
+    assert(motion_b.get_shape()->type() == shape_type::circle);
+
+    // rotation of the circle does not affect the contact, but rotation of the
+    // polygon does, in which case the time of impact is found iteratively
+    if (motion_a.get_angular_velocity() != 0.f) {
+        return rotating_convex_circle_toi(contact, motion_a, motion_b, delta_time, num_iterations);
+    }
+
+    vec2 dp_a = motion_a.get_linear_velocity() * delta_time;
+    vec2 dp_b = motion_b.get_linear_velocity() * delta_time;
+    vec2 direction = motion_b.get_linear_velocity() - motion_a.get_linear_velocity();
+
+    if (direction == vec2_zero) {
+        return 1.f;
+    }
+
+    contact = physics::collide(motion_a, motion_b).get_contact();
+    ++num_iterations;
+
+    // bodies are initially touching
+    if (contact.distance < epsilon) {
+        return contact.normal.dot(direction) >= 0.f ? 1.f : 0.f;
+    }
+
+    // cast the center of the circle against the polygon expanded by the
+    // radius of the circle in the local space of the polygon
+    polygon_vertices polygon(motion_a.get_shape());
+    float radius = static_cast<circle_shape const*>(motion_b.get_shape())->radius();
+
+    mat3 world_to_local = motion_a.get_inverse_transform();
+    vec2 start = motion_b.get_position() * world_to_local;
+    vec2 delta = (vec3(dp_b - dp_a) * world_to_local).to_vec2();
+    float fraction = 1.f;
+
+    for (std::size_t ii = 0; ii < polygon.size(); ++ii) {
+        vec2 v0 = polygon[ii];
+        vec2 v1 = polygon[ii + 1];
+
+        // intersection with the edge translated by the radius
+        vec2 n = polygon.normal(ii);
+        float d = n.dot(delta);
+        if (d < 0.f) {
+            float t = (radius - n.dot(start - v0)) / d;
+            if (t >= 0.f && t < fraction) {
+                float u = (start + delta * t - v0).dot(v1 - v0);
+                if (u >= 0.f && u <= (v1 - v0).length_sqr()) {
+                    fraction = t;
+                }
+            }
+        }
+
+        // intersection with the circle around the vertex
+        if (radius > 0.f) {
+            vec2 p = start - v0;
+            float a = delta.dot(delta);
+            float b = p.dot(delta);
+            float c = p.dot(p) - radius * radius;
+            float discriminant = b * b - a * c;
+            if (b < 0.f && c > 0.f && discriminant >= 0.f) {
+                float t = (-b - std::sqrt(discriminant)) / a;
+                if (t < fraction) {
+                    fraction = t;
+                }
+            }
+        }
+    }
+
+    if (fraction >= 1.f) {
+        return 1.f;
+    }
+
+    motion_a.set_position(motion_a.get_position() + dp_a * fraction);
+    motion_b.set_position(motion_b.get_position() + dp_b * fraction);
+    contact = physics::collide(motion_a, motion_b).get_contact();
+    ++num_iterations;
+    return fraction;
+}
+
+//------------------------------------------------------------------------------
+float trace::rotating_convex_circle_toi(contact& contact, motion motion_a, motion motion_b, float delta_time, int& num_iterations)
+{
+    assert(motion_a.get_shape()->type() == shape_type::box || motion_a.get_shape()->type() == shape_type::convex);
+    assert(motion_b.get_shape()->type() == shape_type::circle);
+
+    vec2 p0_a = motion_a.get_position();
+    vec2 p0_b = motion_b.get_position();
+    float r0_a = motion_a.get_rotation();
+
+    vec2 dp_a = motion_a.get_linear_velocity() * delta_time;
+    vec2 dp_b = motion_b.get_linear_velocity() * delta_time;
+    float dr_a = motion_a.get_angular_velocity() * delta_time;
+
+    // bodies do not overlap during this time step
+    if (!swept_bounds(motion_a, delta_time).intersects(swept_bounds(motion_b, delta_time))) {
+        return 1.f;
+    }
+
+    float radius = static_cast<circle_shape const*>(motion_b.get_shape())->radius();
+    collide::contact_func fn = collide::contact_function(motion_a.get_shape()->type(), shape_type::circle);
+
+    // Each iteration finds the closest features at `fraction` and builds a
+    // separating plane which is fixed in the local space of A. The plane
+    // supports A at all times so the separation of the circle from the plane
+    // never exceeds the distance between the bodies, and the first root of the
+    // separation is a safe time to advance to. Unlike conservative advancement
+    // the root is found without further contact queries.
+    float fraction = 0.f;
+    for (int iteration = 0; iteration < max_toi_iterations; ++iteration) {
+        motion_a.set_position(p0_a + dp_a * fraction);
+        motion_a.set_rotation(r0_a + dr_a * fraction);
+        motion_b.set_position(p0_b + dp_b * fraction);
+
+        contact = physics::collide(fn, motion_a, motion_b).get_contact();
+        ++num_iterations;
+
+        vec2 direction = motion_b.get_linear_velocity(contact.point)
+                       - motion_a.get_linear_velocity(contact.point);
+
+        if (contact.normal.dot(direction) >= 0.f) {
+            return 1.f;
+        }
+
+        if (contact.distance < toi_tolerance) {
+            return fraction;
+        }
+
+        mat3 world_to_local = motion_a.get_inverse_transform();
+        vec2 local_point = contact.point * world_to_local;
+        vec2 local_normal = (vec3(contact.normal) * world_to_local).to_vec2();
+
+        auto const separation = [&](float t) {
+            mat3 local_to_world = mat3::transform(p0_a + dp_a * t, r0_a + dr_a * t);
+            vec2 point = local_point * local_to_world;
+            vec2 normal = (vec3(local_normal) * local_to_world).to_vec2();
+            return normal.dot(p0_b + dp_b * t - point) - radius;
+        };
+
+        // separated along the plane at the end of the step
+        float t2 = 1.f;
+        float s2 = separation(t2);
+        if (s2 > toi_tolerance) {
+            return 1.f;
+        }
+
+        // find the root of the separation by alternating secant and bisection
+        // steps, `t1` always has positive separation
+        float t1 = fraction;
+        float s1 = contact.distance;
+        for (int root_iteration = 0; root_iteration < max_root_iterations; ++root_iteration) {
+            float t = (root_iteration & 1) ? .5f * (t1 + t2)
+                                           : t1 + s1 * (t2 - t1) / (s1 - s2);
+            float s = separation(t);
+
+            if (std::abs(s) < .25f * toi_tolerance) {
+                t1 = t;
+                break;
+            }
+
+            if (s > 0.f) {
+                t1 = t;
+                s1 = s;
+            } else {
+                t2 = t;
+                s2 = s;
+            }
+        }
+
+        assert(!isnan(t1));
+        fraction = t1;
+    }
+
+    // iteration budget exhausted while the bodies are still separated, which
+    // is not a contact, `fraction` is only a lower bound on the time of impact
+    return 1.f;
+}
+
 } // namespace physics
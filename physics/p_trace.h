@@ -16,10 +16,18 @@ class trace
 {
 public:
     trace(rigid_body const* body, vec2 start, vec2 end);
-    trace(rigid_body const* body_a, rigid_body const* body_b, float delta_time);
+    //! Trace a segment against `shape` at the given position and rotation,
+    //! e.g. at an interpolated transform, without copying a rigid body.
+    trace(shape const* shape, vec2 position, float rotation, vec2 start, vec2 end);
+    //! If `cache` is not null collision queries are warm started from and
+    //! update the simplex caches for each pair of shapes in `cache`.
+    trace(rigid_body const* body_a, rigid_body const* body_b, float delta_time, pair_cache* cache = nullptr);
 
     float get_fraction() const { return _fraction; }
 
+    //! Number of contact queries used to find the time of impact
+    int get_num_iterations() const { return _num_iterations; }
+
     contact const& get_contact() const {
         return _contact;
     }
@@ -29,16 +37,36 @@ protected:
 
     contact _contact;
 
+    int _num_iterations;
+
     constexpr static int max_iterations = 64;
     constexpr static float epsilon = 1e-6f;
 
+    //! Maximum number of separating planes used by the time of impact solver
+    constexpr static int max_toi_iterations = 8;
+    //! Maximum number of root finding steps for each separating plane
+    constexpr static int max_root_iterations = 16;
+    //! Distance at which the time of impact solver considers bodies touching
+    constexpr static float toi_tolerance = 1e-3f;
+
 protected:
-    static float dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time);
-    static float compound_compound_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time);
-    static float compound_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time);
-    static float convex_compound_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time);
-    static float convex_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time);
-    static float convex_point_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time);
+    using dispatch_func = float (*)(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations);
+
+    //! Trace functions indexed by the shape types of A and B
+    static dispatch_func const dispatch_table[num_shape_types][num_shape_types];
+
+    static float dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations);
+    static float compound_compound_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations);
+    static float compound_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations);
+    static float convex_compound_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations);
+    static float convex_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations);
+    static float circle_circle_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations);
+    static float circle_convex_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations);
+    static float convex_circle_dispatch(contact& contact, motion motion_a, motion motion_b, float delta_time, pair_cache* cache, int& num_iterations);
+
+    //! Time of impact between a rotating polygon and a circle by bilateral
+    //! advancement, see `convex_circle_dispatch`.
+    static float rotating_convex_circle_toi(contact& contact, motion motion_a, motion motion_b, float delta_time, int& num_iterations);
 };
 
 } // namespace physics
@@ -7,10 +7,12 @@
 #include "p_rigidbody.h"
 #include "p_trace.h"
 
+#include "cm_threadpool.h"
+
 #include <cassert>
 #include <algorithm>
-#include <iterator>
-#include <numeric>
+#include <array>
+#include <chrono>
 #include <queue>
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -18,28 +20,137 @@ namespace physics {
 
 //------------------------------------------------------------------------------
 world::world(filter_callback_type filter_callback, collision_callback_type collision_callback)
-    : _filter_callback(filter_callback)
+    : _allow_sleep(true)
+    , _linear_sleep_tolerance(.1f)
+    , _angular_sleep_tolerance(math::deg2rad(2.f))
+    , _time_to_sleep(.5f)
+    , _filter_callback(filter_callback)
     , _collision_callback(collision_callback)
+    , _thread_pool(nullptr)
+    , _stats{}
+    , _defer_updates(false)
 {
 }
 
+//------------------------------------------------------------------------------
+world::~world()
+{
+    for (std::size_t ii = 0, sz = _bodies.size(); ii < sz; ++ii) {
+        detach_body(ii);
+    }
+}
+
 //------------------------------------------------------------------------------
 void world::add_body(physics::rigid_body* body)
 {
+    assert(!_defer_updates);
     assert(std::find(_bodies.begin(), _bodies.end(), body) == _bodies.end());
     _bodies.push_back(body);
+    _proxies.push_back(_broadphase.insert(body->get_bounds()));
+
+    if (_proxies.back() >= _proxy_bodies.size()) {
+        _proxy_bodies.resize(_proxies.back() + 1);
+        _proxy_generations.resize(_proxies.back() + 1, 0);
+    }
+    _proxy_bodies[_proxies.back()] = _bodies.size() - 1;
+
+    // move body state into the body store
+    body->_index = _store.push_back(body->_motion,
+                                    body->_inverse_mass,
+                                    body->_inverse_inertia,
+                                    body->_material,
+                                    body->_collision_filter,
+                                    body->get_bounds());
+    assert(body->_index == _bodies.size() - 1);
+    body->_store = &_store;
+    body->_world = this;
+    body->_proxy = _tree.insert(body, body->get_bounds());
+
+    // new bodies are awake and have the highest index
+    _awake_bodies.push_back(body->_index);
 }
 
 //------------------------------------------------------------------------------
 void world::remove_body(physics::rigid_body* body)
 {
-    assert(std::find(_bodies.begin(), _bodies.end(), body) != _bodies.end());
-    _bodies.erase(std::find(_bodies.begin(), _bodies.end(), body));
+    assert(!_defer_updates);
+    std::size_t index = body->_index;
+    assert(index < _bodies.size() && _bodies[index] == body);
+
+    // caches for pairs with this proxy are discarded lazily, either at the end
+    // of the next step or when the proxy id is reused, see `find_pair_cache`
+    ++_proxy_generations[_proxies[index]];
+
+    _broadphase.remove(_proxies[index]);
+    _tree.remove(body->_proxy);
+    detach_body(index);
+
+    // move the last body into the removed slot
+    std::size_t last = _bodies.size() - 1;
+    _bodies[index] = _bodies[last];
+    _proxies[index] = _proxies[last];
+    _bodies.pop_back();
+    _proxies.pop_back();
+    _store.swap_erase(index);
+
+    // the awake list is sorted so the last body can only be at the end
+    bool last_awake = _awake_bodies.size() && _awake_bodies.back() == last;
+    if (last_awake) {
+        _awake_bodies.pop_back();
+    }
+    auto it = std::lower_bound(_awake_bodies.begin(), _awake_bodies.end(), index);
+    if (it != _awake_bodies.end() && *it == index) {
+        _awake_bodies.erase(it);
+    }
+
+    if (index != last) {
+        _proxy_bodies[_proxies[index]] = index;
+        _bodies[index]->_index = index;
+        if (last_awake) {
+            _awake_bodies.insert(std::lower_bound(_awake_bodies.begin(), _awake_bodies.end(), index), index);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+pair_cache& world::find_pair_cache(std::size_t body_a, std::size_t body_b)
+{
+    uint32_t generation_a = _proxy_generations[_proxies[body_a]];
+    uint32_t generation_b = _proxy_generations[_proxies[body_b]];
+
+    cached_pair& entry = _pair_caches[(uint64_t(_proxies[body_a]) << 32) | uint64_t(_proxies[body_b])];
+
+    // discard stale caches from removed bodies whose proxy ids were reused
+    if (entry.generations[0] != generation_a || entry.generations[1] != generation_b) {
+        entry.cache = pair_cache();
+        entry.generations[0] = generation_a;
+        entry.generations[1] = generation_b;
+    }
+
+    entry.used = true;
+    return entry.cache;
+}
+
+//------------------------------------------------------------------------------
+void world::detach_body(std::size_t index)
+{
+    // copy body state out of the body store
+    physics::rigid_body* body = _bodies[index];
+    body->_motion = _store.get_motion(index);
+    body->_inverse_mass = _store.get_inverse_mass(index);
+    body->_inverse_inertia = _store.get_inverse_inertia(index);
+    body->_material = _store.get_material(index);
+    body->_collision_filter = _store.get_collision_filter(index);
+
+    body->_world = nullptr;
+    body->_store = nullptr;
 }
 
 //------------------------------------------------------------------------------
 void world::step(float delta_time)
 {
+    assert(!_defer_updates);
+
     struct candidate {
         std::size_t body_b;
         float fraction;
@@ -50,9 +161,71 @@ void world::step(float delta_time)
         }
     };
 
+    using clock = std::chrono::steady_clock;
+    auto seconds = [](clock::duration d) {
+        return std::chrono::duration<float>(d).count();
+    };
+
+    _stats = {};
+    clock::time_point start = clock::now();
+
     // calculate all overlapping body pairs, including permutations
     std::vector<overlap> overlaps = generate_overlaps(delta_time);
 
+    // find or create the persistent cache for each overlapping pair
+    std::vector<pair_cache*> caches(overlaps.size());
+    for (std::size_t idx = 0; idx < overlaps.size(); ++idx) {
+        caches[idx] = &find_pair_cache(overlaps[idx].first, overlaps[idx].second);
+    }
+
+    clock::time_point overlap_end = clock::now();
+    _stats.overlap_time = seconds(overlap_end - start);
+    _stats.num_pairs = _broadphase.pairs().size();
+    _stats.num_overlaps = overlaps.size();
+
+    // trace all overlapping pairs in parallel, the results remain valid until
+    // the velocity of either body is modified during collision response. Each
+    // trace updates a copy of the pair cache which is only committed if the
+    // result is used, so that results match the single-threaded path.
+    struct precomputed_trace {
+        float fraction;
+        physics::contact contact;
+        pair_cache cache;
+        int num_iterations;
+    };
+
+    // tracing in parallel only pays off if there are threads other than this one
+    std::vector<precomputed_trace> traces;
+    if (_thread_pool && _thread_pool->size() > 1) {
+        traces.resize(overlaps.size());
+        _thread_pool->parallel_for(overlaps.size(), [this, &overlaps, &caches, &traces, delta_time](std::size_t idx) {
+            traces[idx].cache = *caches[idx];
+            physics::trace tr(_bodies[overlaps[idx].first], _bodies[overlaps[idx].second], delta_time, &traces[idx].cache);
+            traces[idx].fraction = tr.get_fraction();
+            traces[idx].contact = tr.get_contact();
+            traces[idx].num_iterations = tr.get_num_iterations();
+        }, 16);
+        _stats.num_traces += overlaps.size();
+        for (auto const& tr : traces) {
+            add_trace_iterations(tr.num_iterations);
+        }
+    }
+
+    // bodies which have been modified by collision response
+    std::vector<bool> touched(_bodies.size(), false);
+
+    // position and velocity of a body, precomputed traces are only valid while
+    // these are unchanged
+    auto motion_state = [this](std::size_t index) {
+        vec2 position = _store.get_position(index);
+        vec2 velocity = _store.get_linear_velocity(index);
+        return std::array<float, 6>{
+            position.x, position.y, _store.get_rotation(index),
+            velocity.x, velocity.y, _store.get_angular_velocity(index)};
+    };
+    // pairs of bodies which collided, used to build islands for sleeping
+    std::vector<overlap> contacts;
+
     for (std::size_t idx = 0; idx < overlaps.size();) {
         std::size_t ii = overlaps[idx].first;
 
@@ -61,13 +234,22 @@ void world::step(float delta_time)
         for (; idx < overlaps.size() && overlaps[idx].first == ii; ++idx) {
             std::size_t jj = overlaps[idx].second;
 
-            // check collision
-            physics::trace tr(_bodies[ii], _bodies[jj], delta_time);
-            if (tr.get_fraction() == 1.f) {
-                continue;
+            // check collision, recalculate if either body has been modified
+            if (traces.size() && !touched[ii] && !touched[jj]) {
+                *caches[idx] = traces[idx].cache;
+                if (traces[idx].fraction == 1.f) {
+                    continue;
+                }
+                candidates.push({jj, traces[idx].fraction, traces[idx].contact});
+            } else {
+                physics::trace tr(_bodies[ii], _bodies[jj], delta_time, caches[idx]);
+                ++_stats.num_traces;
+                add_trace_iterations(tr.get_num_iterations());
+                if (tr.get_fraction() == 1.f) {
+                    continue;
+                }
+                candidates.push({jj, tr.get_fraction(), tr.get_contact()});
             }
-
-            candidates.push({jj, tr.get_fraction(), tr.get_contact()});
         }
 
         // use the earliest collision candidate
@@ -83,24 +265,279 @@ void world::step(float delta_time)
             physics::collision c = physics::collision(candidate.contact);
             c.impulse = collision_impulse(_bodies[ii], _bodies[jj], c);
 
-            // check collision callback
-            if (_collision_callback && !_collision_callback(_bodies[ii], _bodies[jj], c)) {
-                continue;
-            }
+            // check collision callback, the callback is allowed to modify
+            // either body even if it rejects the collision. Precomputed traces
+            // are only invalidated for bodies whose motion actually changed.
+            auto state_a = motion_state(ii);
+            auto state_b = motion_state(jj);
+
+            bool accepted = !_collision_callback || _collision_callback(_bodies[ii], _bodies[jj], c);
 
             // collision response
-            _bodies[ii]->apply_impulse(-c.impulse, c.point);
-            _bodies[jj]->apply_impulse( c.impulse, c.point);
+            if (accepted) {
+                _bodies[ii]->apply_impulse(-c.impulse, c.point);
+                _bodies[jj]->apply_impulse( c.impulse, c.point);
+            }
+
+            if (motion_state(ii) != state_a) {
+                touched[ii] = true;
+            }
+            if (motion_state(jj) != state_b) {
+                touched[jj] = true;
+            }
+
+            if (!accepted) {
+                continue;
+            }
 
+            contacts.push_back({ii, jj});
+            ++_stats.num_collisions;
             break;
         }
     }
 
+    // discard caches for pairs which are no longer overlapping
+    for (auto it = _pair_caches.begin(); it != _pair_caches.end();) {
+        if (!it->second.used) {
+            it = _pair_caches.erase(it);
+        } else {
+            it->second.used = false;
+            ++it;
+        }
+    }
+
+    clock::time_point trace_end = clock::now();
+    _stats.trace_time = seconds(trace_end - overlap_end);
+
     // move
 
-    for (std::size_t ii = 0; ii < _bodies.size(); ++ii) {
-        _bodies[ii]->set_position(_bodies[ii]->get_position() + _bodies[ii]->get_linear_velocity() * delta_time);
-        _bodies[ii]->set_rotation(_bodies[ii]->get_rotation() + _bodies[ii]->get_angular_velocity() * delta_time);
+    if (_awake_bodies.size() == _bodies.size()) {
+        _store.integrate(delta_time);
+    } else {
+        _store.integrate(delta_time, _awake_bodies);
+    }
+
+    for (std::size_t ii : _awake_bodies) {
+        vec2 displacement = _store.get_linear_velocity(ii) * delta_time;
+        _store.update_bounds(ii);
+        _tree.update(_bodies[ii]->_proxy, _store.get_bounds(ii), displacement);
+    }
+
+    _stats.num_awake_bodies = _awake_bodies.size();
+
+    update_sleep(delta_time, contacts);
+
+    _stats.integrate_time = seconds(clock::now() - trace_end);
+}
+
+//------------------------------------------------------------------------------
+void world::raycast(ray const* rays, std::size_t num_rays, ray_hit* hits) const
+{
+    for (std::size_t ii = 0; ii < num_rays; ++ii) {
+        hits[ii].body = nullptr;
+        hits[ii].fraction = 1.f;
+        hits[ii].contact = {};
+    }
+
+    for (std::size_t first = 0; first < num_rays; first += aabb_tree::max_packet) {
+        std::size_t num_segments = std::min(aabb_tree::max_packet, num_rays - first);
+
+        vec2 starts[aabb_tree::max_packet];
+        vec2 ends[aabb_tree::max_packet];
+        for (std::size_t ii = 0; ii < num_segments; ++ii) {
+            starts[ii] = rays[first + ii].start;
+            ends[ii] = rays[first + ii].end;
+        }
+
+        _tree.raycast(num_segments, starts, ends, [this, rays, hits, first](aabb_tree::proxy id, std::size_t index, float max_fraction) {
+            ray const& r = rays[first + index];
+            ray_hit& hit = hits[first + index];
+            rigid_body* body = _tree.get_body(id);
+
+            if (!r.filter.collides_with(body->get_collision_filter())) {
+                return max_fraction;
+            }
+
+            physics::trace tr(body, r.start, r.end);
+            if (tr.get_fraction() < hit.fraction
+                    || (tr.get_fraction() == hit.fraction && hit.body && body->_index < hit.body->_index)) {
+                hit.body = body;
+                hit.fraction = tr.get_fraction();
+                hit.contact = tr.get_contact();
+            }
+            return hit.fraction;
+        });
+    }
+}
+
+//------------------------------------------------------------------------------
+void world::set_sleep_parameters(float linear_tolerance, float angular_tolerance, float time_to_sleep)
+{
+    _linear_sleep_tolerance = linear_tolerance;
+    _angular_sleep_tolerance = angular_tolerance;
+    _time_to_sleep = time_to_sleep;
+}
+
+//------------------------------------------------------------------------------
+void world::set_allow_sleep(bool allow_sleep)
+{
+    _allow_sleep = allow_sleep;
+    if (!allow_sleep) {
+        for (auto* body : _bodies) {
+            wake_body(body);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void world::begin_deferred_updates()
+{
+    assert(!_defer_updates);
+    _defer_updates = true;
+}
+
+//------------------------------------------------------------------------------
+void world::end_deferred_updates()
+{
+    assert(_defer_updates);
+    _defer_updates = false;
+
+    std::sort(_deferred_moves.begin(), _deferred_moves.end());
+    _deferred_moves.erase(std::unique(_deferred_moves.begin(), _deferred_moves.end()), _deferred_moves.end());
+    std::sort(_deferred_wakes.begin(), _deferred_wakes.end());
+    _deferred_wakes.erase(std::unique(_deferred_wakes.begin(), _deferred_wakes.end()), _deferred_wakes.end());
+
+    // bodies are moved before they are woken so that the broadphase is
+    // updated for bodies which were asleep when moved, same as `update_body`
+    for (std::size_t index : _deferred_moves) {
+        _tree.update(_bodies[index]->_proxy, _store.get_bounds(index));
+        if (!_store.is_awake(index)) {
+            _broadphase.update(_proxies[index], _store.get_bounds(index));
+        }
+    }
+
+    for (std::size_t index : _deferred_wakes) {
+        wake_body(_bodies[index]);
+    }
+
+    _deferred_moves.clear();
+    _deferred_wakes.clear();
+}
+
+//------------------------------------------------------------------------------
+void world::wake_body(physics::rigid_body* body)
+{
+    assert(body->_world == this);
+    std::size_t index = body->_index;
+    _store.set_sleep_time(index, 0.f);
+    if (_store.is_awake(index)) {
+        return;
+    }
+
+    if (_defer_updates) {
+        std::lock_guard<std::mutex> lock(_deferred_mutex);
+        _deferred_wakes.push_back(index);
+        return;
+    }
+
+    _store.set_awake(index, true);
+    _awake_bodies.insert(std::lower_bound(_awake_bodies.begin(), _awake_bodies.end(), index), index);
+}
+
+//------------------------------------------------------------------------------
+std::size_t world::find_island(std::size_t index)
+{
+    // path halving
+    while (_island_parent[index] != index) {
+        _island_parent[index] = _island_parent[_island_parent[index]];
+        index = _island_parent[index];
+    }
+    return index;
+}
+
+//------------------------------------------------------------------------------
+void world::update_sleep(float delta_time, std::vector<overlap> const& contacts)
+{
+    if (!_allow_sleep) {
+        return;
+    }
+
+    if (_island_parent.size() < _bodies.size()) {
+        _island_parent.resize(_bodies.size());
+        _island_sleep_time.resize(_bodies.size());
+    }
+
+    float linear_tolerance_sqr = _linear_sleep_tolerance * _linear_sleep_tolerance;
+
+    for (std::size_t ii : _awake_bodies) {
+        if (_store.get_linear_velocity(ii).length_sqr() > linear_tolerance_sqr
+                || std::abs(_store.get_angular_velocity(ii)) > _angular_sleep_tolerance) {
+            _store.set_sleep_time(ii, 0.f);
+        } else {
+            _store.set_sleep_time(ii, _store.get_sleep_time(ii) + delta_time);
+        }
+
+        _island_parent[ii] = ii;
+        _island_sleep_time[ii] = _store.get_sleep_time(ii);
+    }
+
+    // bodies in contact can only sleep together, static bodies are excluded
+    // so that they do not join everything that touches them into one island
+    for (auto const& pair : contacts) {
+        std::size_t ii = pair.first;
+        std::size_t jj = pair.second;
+        if (!_store.is_awake(ii) || !_store.is_awake(jj)) {
+            continue;
+        }
+        if ((!_store.get_inverse_mass(ii) && !_store.get_inverse_inertia(ii))
+                || (!_store.get_inverse_mass(jj) && !_store.get_inverse_inertia(jj))) {
+            continue;
+        }
+
+        std::size_t root_a = find_island(ii);
+        std::size_t root_b = find_island(jj);
+        if (root_a != root_b) {
+            // keep the lower index as the root so that results do not depend on contact order
+            if (root_b < root_a) {
+                std::swap(root_a, root_b);
+            }
+            _island_parent[root_b] = root_a;
+            _island_sleep_time[root_a] = std::min(_island_sleep_time[root_a], _island_sleep_time[root_b]);
+        }
+    }
+
+    // remove sleeping islands from the awake list
+    std::size_t num_awake = 0;
+    for (std::size_t ii : _awake_bodies) {
+        if (_island_sleep_time[find_island(ii)] < _time_to_sleep) {
+            _awake_bodies[num_awake++] = ii;
+            continue;
+        }
+
+        _store.set_awake(ii, false);
+        _store.set_linear_velocity(ii, vec2_zero);
+        _store.set_angular_velocity(ii, 0.f);
+    }
+    _awake_bodies.resize(num_awake);
+}
+
+//------------------------------------------------------------------------------
+void world::update_body(physics::rigid_body* body)
+{
+    assert(body->_world == this);
+    _store.update_bounds(body->_index);
+
+    if (_defer_updates) {
+        std::lock_guard<std::mutex> lock(_deferred_mutex);
+        _deferred_moves.push_back(body->_index);
+        return;
+    }
+
+    _tree.update(body->_proxy, _store.get_bounds(body->_index));
+
+    // the broadphase is only updated for awake bodies during each step
+    if (!_store.is_awake(body->_index)) {
+        _broadphase.update(_proxies[body->_index], _store.get_bounds(body->_index));
     }
 }
 
@@ -192,53 +629,49 @@ vec2 world::collision_impulse(
 }
 
 //------------------------------------------------------------------------------
-std::vector<world::overlap> world::generate_overlaps(float delta_time) const
+std::vector<world::overlap> world::generate_overlaps(float delta_time)
 {
-    std::vector<bounds> swept_bounds(_bodies.size());
-    for (std::size_t ii = 0, sz = _bodies.size(); ii < sz; ++ii) {
-        // todo: include rotation
-        swept_bounds[ii] = bounds::from_translation(_bodies[ii]->get_bounds(),
-                                                    _bodies[ii]->get_linear_velocity() * delta_time);
-    }
-
-    std::vector<overlap> axis_overlaps[2];
-    std::vector<size_t> sorted(_bodies.size());
-    std::iota(sorted.begin(), sorted.end(), 0);
-
-    for (int axis = 0; axis < 2; ++axis) {
-        // sort bounds on the current axis
-        std::sort(sorted.begin(), sorted.end(),
-            [&swept_bounds, axis](std::size_t lhs, std::size_t rhs) {
-                return swept_bounds[lhs][0][axis] < swept_bounds[rhs][0][axis];
-            });
-
-        // generate overlaps on the current axis
-        for (std::size_t ii = 0, sz = _bodies.size(); ii < sz; ++ii) {
-            bounds b = swept_bounds[sorted[ii]];
-            for (std::size_t jj = ii + 1; jj < sz; ++jj) {
-                if (b[1][axis] < swept_bounds[sorted[jj]][0][axis]) {
-                    break;
-                }
+    // todo: include rotation
+    if (_awake_bodies.size() == _bodies.size()) {
+        _store.swept_bounds(delta_time, _swept_bounds);
+    } else {
+        _store.swept_bounds(delta_time, _awake_bodies, _swept_bounds);
+    }
 
-                // check collision filter, note: filter is not necessarily symmetric
-                if (!_filter_callback || _filter_callback(_bodies[sorted[ii]], _bodies[sorted[jj]])) {
-                    axis_overlaps[axis].push_back({sorted[ii], sorted[jj]});
-                }
-                if (!_filter_callback || _filter_callback(_bodies[sorted[jj]], _bodies[sorted[ii]])) {
-                    axis_overlaps[axis].push_back({sorted[jj], sorted[ii]});
-                }
-            }
+    // sleeping bodies do not move so their proxies are left unchanged
+    _proxy_updates.clear();
+    for (std::size_t ii : _awake_bodies) {
+        _proxy_updates.push_back({_proxies[ii], _swept_bounds[ii]});
+    }
+    _broadphase.update(_proxy_updates);
+
+    std::vector<overlap> overlaps;
+    overlaps.reserve(_broadphase.pairs().size() * 2);
+
+    for (auto const& pair : _broadphase.pairs()) {
+        std::size_t ii = _proxy_bodies[pair.first];
+        std::size_t jj = _proxy_bodies[pair.second];
+
+        // sleeping bodies cannot collide with each other
+        if (!_store.is_awake(ii) && !_store.is_awake(jj)) {
+            continue;
         }
 
-        // sort overlaps on the current axis by body ids
-        std::sort(axis_overlaps[axis].begin(), axis_overlaps[axis].end());
+        // check collision filters before the filter callback, note: filters
+        // are not necessarily symmetric
+        collision_filter const& filter_a = _store.get_collision_filter(ii);
+        collision_filter const& filter_b = _store.get_collision_filter(jj);
+
+        if (filter_a.collides_with(filter_b) && (!_filter_callback || _filter_callback(_bodies[ii], _bodies[jj]))) {
+            overlaps.push_back({ii, jj});
+        }
+        if (filter_b.collides_with(filter_a) && (!_filter_callback || _filter_callback(_bodies[jj], _bodies[ii]))) {
+            overlaps.push_back({jj, ii});
+        }
     }
 
-    // generate the intersection of overlaps on both axes
-    std::vector<overlap> overlaps;
-    std::set_intersection(axis_overlaps[0].begin(), axis_overlaps[0].end(),
-                          axis_overlaps[1].begin(), axis_overlaps[1].end(),
-                          std::back_inserter(overlaps));
+    // sort overlaps by body ids
+    std::sort(overlaps.begin(), overlaps.end());
     return overlaps;
 }
 
@@ -4,14 +4,20 @@
 #pragma once
 
 #include "cm_vector.h"
+#include "p_aabbtree.h"
+#include "p_broadphase.h"
 #include "p_collide.h"
+#include "p_rigidbody.h"
 #include <functional>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
+class thread_pool;
+
 ////////////////////////////////////////////////////////////////////////////////
 namespace physics {
 
-class rigid_body;
 class trace;
 class shape;
 
@@ -24,26 +30,173 @@ struct collision : contact
     explicit collision(contact const& c) : contact(c) {}
 };
 
+//------------------------------------------------------------------------------
+//! Segment for a batched ray cast, only bodies whose collision filter passes
+//! `filter.collides_with` are tested.
+struct ray
+{
+    vec2 start;
+    vec2 end;
+    collision_filter filter;
+};
+
+//------------------------------------------------------------------------------
+//! Nearest hit of a ray in a batched ray cast
+struct ray_hit
+{
+    rigid_body* body; //!< Nearest body, null if the ray did not hit anything
+    float fraction; //!< Fraction of the segment at the hit, 1 if no hit
+    physics::contact contact; //!< Contact on the body at the hit
+};
+
+//------------------------------------------------------------------------------
+//! Timings and counters for the most recent call to world::step
+struct step_stats
+{
+    float overlap_time; //!< Seconds spent finding overlapping pairs
+    float trace_time; //!< Seconds spent tracing pairs and resolving collisions
+    float integrate_time; //!< Seconds spent integrating and updating bounds
+
+    std::size_t num_pairs; //!< Number of pairs with overlapping swept bounds
+    std::size_t num_overlaps; //!< Number of ordered pairs which passed the filter
+    std::size_t num_traces; //!< Number of traces, including recalculated traces
+    std::size_t num_trace_iterations; //!< Number of contact queries over all traces
+    std::size_t max_trace_iterations; //!< Largest number of contact queries in a single trace
+    std::size_t num_collisions; //!< Number of collisions which were resolved
+    std::size_t num_awake_bodies; //!< Number of bodies which were simulated
+};
+
 //------------------------------------------------------------------------------
 class world
 {
 public:
+    //! Filter callbacks are only called for pairs which pass the collision
+    //! filters of both bodies, see physics::collision_filter.
     using filter_callback_type = std::function<bool(physics::rigid_body const* body_a, physics::rigid_body const* body_b)>;
+    //! Collision callbacks are called serially in a deterministic order and
+    //! must not modify any bodies other than `body_a` and `body_b`.
     using collision_callback_type = std::function<bool(physics::rigid_body const* body_a, physics::rigid_body const* body_b, physics::collision const& collision)>;
 
     world(filter_callback_type filter_callback, collision_callback_type collision_callback);
+    ~world();
 
     void add_body(physics::rigid_body* body);
     void remove_body(physics::rigid_body* body);
 
     void step(float delta_time);
 
+    //! Use the given thread pool to calculate contacts during `step`, results
+    //! are identical to the single-threaded path. Pass nullptr to disable.
+    void set_thread_pool(thread_pool* pool) { _thread_pool = pool; }
+
+    //! Bodies whose linear and angular speed stay below the given tolerances
+    //! for `time_to_sleep` seconds are put to sleep, together with all other
+    //! bodies in the same island of contacts. Sleeping bodies are excluded from
+    //! integration and are only checked for collisions against awake bodies.
+    void set_sleep_parameters(float linear_tolerance, float angular_tolerance, float time_to_sleep);
+
+    //! Disabling sleep wakes all sleeping bodies
+    void set_allow_sleep(bool allow_sleep);
+
+    //! Defer updates to the bounding volume tree, broadphase and set of awake
+    //! bodies which are caused by moving or waking bodies until the matching
+    //! call to `end_deferred_updates`. In the meantime bodies can be moved and
+    //! woken from multiple threads as long as each body is only modified by
+    //! a single thread, but bodies must not be added or removed and queries
+    //! must not be made against bodies that are being modified.
+    void begin_deferred_updates();
+    //! Apply deferred updates in order of body index, results do not depend
+    //! on the order in which bodies were modified.
+    void end_deferred_updates();
+
+    //! Number of bodies that are simulated during each step
+    std::size_t num_awake_bodies() const { return _awake_bodies.size(); }
+
+    step_stats const& get_stats() const { return _stats; }
+
+    //! Call `fn(body)` for each body whose bounds intersect `b`, stops
+    //! early if `fn` returns false.
+    template<typename Fn> void query(bounds const& b, Fn&& fn) const;
+
+    //! Call `fn(body)` for each body whose bounds intersect the circle with
+    //! the given `center` and `radius`, stops early if `fn` returns false.
+    template<typename Fn> void query(vec2 center, float radius, Fn&& fn) const;
+
+    //! Same as `query` but only bodies which pass `filter` are considered, as
+    //! if `filter` belonged to a body testing for collision with each body.
+    //! Bodies are filtered before their bounds are tested.
+    template<typename Fn> void query(bounds const& b, collision_filter const& filter, Fn&& fn) const;
+    template<typename Fn> void query(vec2 center, float radius, collision_filter const& filter, Fn&& fn) const;
+
+    //! Call `fn(body, max_fraction)` for each body whose bounds intersect the
+    //! segment from `start` to `end` up to `max_fraction`. `fn` returns the
+    //! fraction of the nearest hit so far so that farther bodies are skipped.
+    template<typename Fn> void raycast(vec2 start, vec2 end, Fn&& fn) const;
+
+    //! Find the nearest hit for each of `num_rays` rays and write it to the
+    //! corresponding entry in `hits`. Rays are cast in packets which share a
+    //! single traversal of the bounding volume tree. Ties are broken by the
+    //! order of bodies in the world so that results do not depend on traversal
+    //! order or on where bodies were allocated.
+    void raycast(ray const* rays, std::size_t num_rays, ray_hit* hits) const;
+
 protected:
     std::vector<physics::rigid_body*> _bodies;
+    //! State of each body, parallel to `_bodies`
+    physics::body_store _store;
+    //! Broadphase proxy for each body, parallel to `_bodies`
+    std::vector<physics::broadphase::proxy> _proxies;
+    //! Index into `_bodies` for each broadphase proxy
+    std::vector<std::size_t> _proxy_bodies;
+
+    physics::broadphase _broadphase;
+    physics::aabb_tree _tree;
+
+    //! Scratch space for swept bounds of each body
+    std::vector<bounds> _swept_bounds;
+    //! Scratch storage for batched broadphase updates
+    std::vector<std::pair<physics::broadphase::proxy, bounds>> _proxy_updates;
+
+    //! Sorted indices of all bodies which are awake
+    std::vector<std::size_t> _awake_bodies;
+
+    //! Scratch space for island construction, parent of each body in a
+    //! disjoint set forest and the minimum sleep time of each island root
+    std::vector<std::size_t> _island_parent;
+    std::vector<float> _island_sleep_time;
+
+    bool _allow_sleep;
+    float _linear_sleep_tolerance;
+    float _angular_sleep_tolerance;
+    float _time_to_sleep;
+
+    struct cached_pair
+    {
+        pair_cache cache;
+        bool used; //!< True if the pair was overlapping during the current step
+        uint32_t generations[2]; //!< Generation of each proxy when cached
+    };
+
+    //! Persistent collision caches for overlapping pairs, keyed by the
+    //! broadphase proxies of the ordered pair of bodies
+    std::unordered_map<uint64_t, cached_pair> _pair_caches;
+    //! Incremented when a proxy is removed to invalidate its pair caches
+    std::vector<uint32_t> _proxy_generations;
 
     filter_callback_type _filter_callback;
     collision_callback_type _collision_callback;
 
+    thread_pool* _thread_pool;
+
+    step_stats _stats;
+
+    //! True between `begin_deferred_updates` and `end_deferred_updates`
+    bool _defer_updates;
+    //! Indices of bodies which have been moved or woken while deferred
+    std::vector<std::size_t> _deferred_moves;
+    std::vector<std::size_t> _deferred_wakes;
+    std::mutex _deferred_mutex;
+
 protected:
     vec2 collision_impulse(physics::rigid_body const* body_a,
                            physics::rigid_body const* body_b,
@@ -51,9 +204,87 @@ protected:
 
     using overlap = std::pair<std::size_t, std::size_t>;
 
+    void add_trace_iterations(int num_iterations) {
+        _stats.num_trace_iterations += num_iterations;
+        _stats.max_trace_iterations = std::max<std::size_t>(_stats.max_trace_iterations, num_iterations);
+    }
+
     //! Return a lexicographically sorted list of all pairs of bodies which
     //! overlap during the next `delta_time` step, including permutations.
-    std::vector<overlap> generate_overlaps(float delta_time) const;
+    std::vector<overlap> generate_overlaps(float delta_time);
+
+    //! Advance sleep timers of all awake bodies and put islands to sleep
+    //! which have been at rest for long enough, `contacts` are the pairs of
+    //! bodies which collided during the current step.
+    void update_sleep(float delta_time, std::vector<overlap> const& contacts);
+
+    //! Return the root of the island containing the body at `index`
+    std::size_t find_island(std::size_t index);
+
+    //! Return the persistent cache for the ordered pair of body indices and
+    //! mark it as used during the current step
+    pair_cache& find_pair_cache(std::size_t body_a, std::size_t body_b);
+
+    friend rigid_body;
+    //! Update cached bounds and the bounding volume tree after `body` has
+    //! been moved outside of `step`
+    void update_body(physics::rigid_body* body);
+
+    //! Add `body` to the set of awake bodies if it is sleeping
+    void wake_body(physics::rigid_body* body);
+
+    //! Copy the state of the body at `index` out of the body store
+    void detach_body(std::size_t index);
 };
 
+//------------------------------------------------------------------------------
+template<typename Fn> void world::query(bounds const& b, Fn&& fn) const
+{
+    _tree.query(b, [this, &b, &fn](aabb_tree::proxy id) {
+        rigid_body* body = _tree.get_body(id);
+        // tree bounds are enlarged, check the actual bounds of the body
+        return !body->get_bounds().intersects(b) || fn(body);
+    });
+}
+
+//------------------------------------------------------------------------------
+template<typename Fn> void world::query(vec2 center, float radius, Fn&& fn) const
+{
+    _tree.query(center, radius, [this, center, radius, &fn](aabb_tree::proxy id) {
+        rigid_body* body = _tree.get_body(id);
+        // tree bounds are enlarged, check the actual bounds of the body
+        return !body->get_bounds().intersects_circle(center, radius) || fn(body);
+    });
+}
+
+//------------------------------------------------------------------------------
+template<typename Fn> void world::query(bounds const& b, collision_filter const& filter, Fn&& fn) const
+{
+    _tree.query(b, [this, &b, &filter, &fn](aabb_tree::proxy id) {
+        rigid_body* body = _tree.get_body(id);
+        return !filter.collides_with(body->get_collision_filter())
+            || !body->get_bounds().intersects(b)
+            || fn(body);
+    });
+}
+
+//------------------------------------------------------------------------------
+template<typename Fn> void world::query(vec2 center, float radius, collision_filter const& filter, Fn&& fn) const
+{
+    _tree.query(center, radius, [this, center, radius, &filter, &fn](aabb_tree::proxy id) {
+        rigid_body* body = _tree.get_body(id);
+        return !filter.collides_with(body->get_collision_filter())
+            || !body->get_bounds().intersects_circle(center, radius)
+            || fn(body);
+    });
+}
+
+//------------------------------------------------------------------------------
+template<typename Fn> void world::raycast(vec2 start, vec2 end, Fn&& fn) const
+{
+    _tree.raycast(start, end, [this, &fn](aabb_tree::proxy id, float max_fraction) {
+        return fn(_tree.get_body(id), max_fraction);
+    });
+}
+
 } // namespace physics
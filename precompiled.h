@@ -13,6 +13,8 @@
 #include "g_session.h"
 //  rendering headers
 #include "r_main.h"
+#if defined(_WIN32)
 #include "r_window.h"
 //  windows headers
 #include "win_main.h"
+#endif // defined(_WIN32)
@@ -41,7 +41,7 @@ system::~system()
 //------------------------------------------------------------------------------
 result system::init()
 {
-    random r;
+    random_generator r;
 
     glBlendColor = (PFNGLBLENDCOLOR )wglGetProcAddress("glBlendColor");
 
@@ -30,7 +30,7 @@ public:
 
     std::vector<vec2> const& vertices() const { return _vertices; }
 
-    bounds bounds() const { return _bounds; }
+    ::bounds bounds() const { return _bounds; }
     bool contains(vec2 point) const;
 
 protected:
@@ -0,0 +1,56 @@
+// r_null.cpp
+//
+
+#include "precompiled.h"
+#pragma hdrstop
+
+#include "r_model.h"
+
+////////////////////////////////////////////////////////////////////////////////
+namespace render {
+
+// The dedicated server never creates a render::system. These definitions only
+// satisfy the draw calls referenced by game objects, which are unreachable
+// without a renderer.
+
+//------------------------------------------------------------------------------
+void system::draw_line(vec2, vec2, color4, color4)
+{
+}
+
+//------------------------------------------------------------------------------
+void system::draw_line(float, vec2, vec2, color4, color4, color4, color4)
+{
+}
+
+//------------------------------------------------------------------------------
+void system::draw_arc(vec2, float, float, float, float, color4)
+{
+}
+
+//------------------------------------------------------------------------------
+void system::draw_box(vec2, vec2, color4)
+{
+}
+
+//------------------------------------------------------------------------------
+void system::draw_triangles(vec2 const*, color4 const*, int const*, std::size_t)
+{
+}
+
+//------------------------------------------------------------------------------
+void system::draw_particles(time_value, render::particle const*, std::size_t)
+{
+}
+
+//------------------------------------------------------------------------------
+void system::draw_model(render::model const*, mat3, color4)
+{
+}
+
+//------------------------------------------------------------------------------
+void system::draw_starfield(vec2)
+{
+}
+
+} // namespace render
@@ -6,8 +6,13 @@
 #include "cm_filesystem.h"
 #include "cm_parser.h"
 
+#if defined(_WIN32)
 #include <Shlobj.h>
 #include <PathCch.h>
+#else
+#include <cstdlib>
+#include <sys/stat.h>
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace config {
@@ -239,6 +244,7 @@ config::scalar& scalar::operator=(float f)
 //------------------------------------------------------------------------------
 int get_config_path(char *path, std::size_t size, bool create = false)
 {
+#if defined(_WIN32)
     PWSTR pszPath;
     WCHAR wPath[1024];
 
@@ -263,6 +269,19 @@ int get_config_path(char *path, std::size_t size, bool create = false)
         narrow_cast<int>(size),
         NULL,
         NULL);
+#else
+    // use $XDG_CONFIG_HOME/quark, or ~/.config/quark if it is not set
+    char const* base = getenv("XDG_CONFIG_HOME");
+    string_buffer directory = base && *base
+        ? string_buffer(va("%s/quark", base))
+        : string_buffer(va("%s/.config/quark", getenv("HOME") ? getenv("HOME") : "."));
+
+    if (create) {
+        mkdir(directory.c_str(), 0755);
+    }
+
+    return snprintf(path, size, "%s/config.ini", directory.c_str());
+#endif
 }
 
 //------------------------------------------------------------------------------
@@ -207,7 +207,11 @@ buffer::~buffer()
 stream open(string::view filename, file::mode mode)
 {
     FILE* f = nullptr;
+#if defined(_WIN32)
     fopen_s(&f, filename.c_str(), mode_to_native(mode));
+#else
+    f = fopen(filename.c_str(), mode_to_native(mode));
+#endif
     return stream_internal(f);
 }
 
@@ -244,6 +248,13 @@ time modified_time(string::view filename)
     } else {
         return static_cast<file::time>(0);
     }
+#else
+    struct stat s;
+    if (!stat(filename.c_str(), &s)) {
+        return static_cast<file::time>(s.st_mtime);
+    } else {
+        return static_cast<file::time>(0);
+    }
 #endif
 }
 
@@ -7,8 +7,7 @@
 
 #include <cstddef>
 #include <cstdint>
-
-typedef struct _iobuf FILE;
+#include <cstdio>
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace file {
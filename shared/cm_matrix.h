@@ -29,7 +29,7 @@ public:
     bool operator==(mat2 const& M) const { return _rows[0] == M[0] && _rows[1] == M[1]; }
     bool operator!=(mat2 const& M) const { return _rows[0] != M[0] || _rows[1] != M[1]; }
     constexpr vec2 operator[](std::size_t idx) const { return _rows[idx]; }
-    vec2& operator[](std::size_t idx) { return _rows[idx]; }
+    constexpr vec2& operator[](std::size_t idx) { return _rows[idx]; }
 
 // basic functions
 
@@ -106,7 +106,7 @@ public:
     bool operator==(mat3 const& M) const { return _rows[0] == M[0] && _rows[1] == M[1] && _rows[2] == M[2]; }
     bool operator!=(mat3 const& M) const { return _rows[0] != M[0] || _rows[1] != M[1] || _rows[2] != M[2]; }
     constexpr vec3 operator[](std::size_t idx) const { return _rows[idx]; }
-    vec3& operator[](std::size_t idx) { return _rows[idx]; }
+    constexpr vec3& operator[](std::size_t idx) { return _rows[idx]; }
 
 // basic functions
 
@@ -219,7 +219,7 @@ public:
     bool operator==(mat4 const& M) const { return _rows[0] == M[0] && _rows[1] == M[1] && _rows[2] == M[2] && _rows[3] == M[3]; }
     bool operator!=(mat4 const& M) const { return _rows[0] != M[0] || _rows[1] != M[1] || _rows[2] != M[2] || _rows[3] != M[3]; }
     constexpr vec4 operator[](std::size_t idx) const { return _rows[idx]; }
-    vec4& operator[](std::size_t idx) { return _rows[idx]; }
+    constexpr vec4& operator[](std::size_t idx) { return _rows[idx]; }
 
 // basic functions
 
@@ -309,19 +309,19 @@ constexpr mat3 mat3_identity = mat3(1,0,0,0,1,0,0,0,1);
 constexpr mat4 mat4_identity = mat4(1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1);
 
 //------------------------------------------------------------------------------
-template<> inline bool isnan<mat2>(mat2 m)
+inline bool isnan(mat2 m)
 {
     return isnan(m[0]) || isnan(m[1]);
 }
 
 //------------------------------------------------------------------------------
-template<> inline bool isnan<mat3>(mat3 m)
+inline bool isnan(mat3 m)
 {
     return isnan(m[0]) || isnan(m[1]) || isnan(m[2]);
 }
 
 //------------------------------------------------------------------------------
-template<> inline bool isnan<mat4>(mat4 m)
+inline bool isnan(mat4 m)
 {
     return isnan(m[0]) || isnan(m[1]) || isnan(m[2]) || isnan(m[3]);
 }
@@ -0,0 +1,67 @@
+// cm_pool.cpp
+//
+
+#include "cm_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+//------------------------------------------------------------------------------
+block_pool::block_pool(std::size_t block_size, std::size_t slab_size)
+    : _block_size(std::max(block_size, sizeof(free_block)))
+    , _size(0)
+    , _free_list(nullptr)
+{
+    // round up to a multiple of the block alignment
+    _block_size = (_block_size + block_alignment - 1) & ~(block_alignment - 1);
+    _blocks_per_slab = std::max<std::size_t>(1, slab_size / _block_size);
+}
+
+//------------------------------------------------------------------------------
+block_pool::~block_pool()
+{
+    assert(_size == 0 && "blocks were not returned to the pool");
+    for (void* slab : _slabs) {
+        ::operator delete(slab, std::align_val_t(block_alignment));
+    }
+}
+
+//------------------------------------------------------------------------------
+void* block_pool::allocate()
+{
+    if (!_free_list) {
+        allocate_slab();
+    }
+
+    free_block* block = _free_list;
+    _free_list = block->next;
+    ++_size;
+    return block;
+}
+
+//------------------------------------------------------------------------------
+void block_pool::free(void* block)
+{
+    assert(block);
+    assert(_size > 0);
+    free_block* head = static_cast<free_block*>(block);
+    head->next = _free_list;
+    _free_list = head;
+    --_size;
+}
+
+//------------------------------------------------------------------------------
+void block_pool::allocate_slab()
+{
+    unsigned char* slab = static_cast<unsigned char*>(
+        ::operator new(_block_size * _blocks_per_slab, std::align_val_t(block_alignment)));
+    _slabs.push_back(slab);
+
+    // link blocks in reverse so that blocks are allocated in address order
+    for (std::size_t ii = _blocks_per_slab; ii > 0; --ii) {
+        free_block* block = reinterpret_cast<free_block*>(slab + (ii - 1) * _block_size);
+        block->next = _free_list;
+        _free_list = block;
+    }
+}
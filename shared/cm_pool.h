@@ -0,0 +1,59 @@
+// cm_pool.h
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//------------------------------------------------------------------------------
+/*
+    Allocator for fixed-size blocks of memory carved out of contiguous slabs
+
+    Blocks are aligned to and padded to a multiple of the cache line size so
+    that no two blocks share a cache line. Freed blocks are kept in an
+    intrusive free list and reused before any new slab is allocated, slabs are
+    only released when the pool is destroyed. Not thread-safe.
+*/
+class block_pool
+{
+public:
+    static constexpr std::size_t block_alignment = 64;
+
+    //! Create a pool for blocks of at least `block_size` bytes which are
+    //! allocated in slabs of at least `slab_size` bytes.
+    explicit block_pool(std::size_t block_size, std::size_t slab_size = 64 * 1024);
+    ~block_pool();
+
+    block_pool(block_pool const&) = delete;
+    block_pool& operator=(block_pool const&) = delete;
+
+    //! Return uninitialized storage for one block
+    void* allocate();
+    //! Return a block to the pool, `block` must have been returned by
+    //! `allocate` on this pool.
+    void free(void* block);
+
+    //! Size of each block in bytes, including padding
+    std::size_t block_size() const { return _block_size; }
+    //! Number of blocks which are currently allocated
+    std::size_t size() const { return _size; }
+    //! Number of blocks in all slabs
+    std::size_t capacity() const { return _slabs.size() * _blocks_per_slab; }
+
+protected:
+    struct free_block
+    {
+        free_block* next;
+    };
+
+    std::size_t _block_size;
+    std::size_t _blocks_per_slab;
+    std::size_t _size;
+
+    free_block* _free_list;
+    std::vector<void*> _slabs;
+
+protected:
+    void allocate_slab();
+};
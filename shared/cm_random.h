@@ -85,4 +85,6 @@ protected:
 };
 
 //------------------------------------------------------------------------------
-using random = random_base<std::minstd_rand>;
+//! Default random number generator. Not named `random` because that would
+//! conflict with the POSIX `random` function from <stdlib.h>.
+using random_generator = random_base<std::minstd_rand>;
@@ -4,6 +4,7 @@
 #include "cm_shared.h"
 
 #include <cstdarg>
+#include <cstdio>
 
 ////////////////////////////////////////////////////////////////////////////////
 namespace detail {
@@ -5,8 +5,14 @@
 #include "cm_shared.h"
 
 #include <cstdarg>
+#include <cstdio>
 #include <algorithm>
 
+#if !defined(_WIN32)
+#include <strings.h>
+#define _strnicmp strncasecmp
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 namespace string {
 
@@ -0,0 +1,123 @@
+// cm_threadpool.cpp
+//
+
+#include "cm_threadpool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+//! True while the current thread is executing a job
+thread_local bool in_job = false;
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+thread_pool::thread_pool(std::size_t num_threads)
+    : _job{}
+    , _generation(0)
+    , _num_busy(0)
+    , _shutdown(false)
+    , _next(0)
+{
+    for (std::size_t ii = 0; ii < num_threads; ++ii) {
+        _threads.push_back(std::thread(&thread_pool::worker, this));
+    }
+}
+
+//------------------------------------------------------------------------------
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _shutdown = true;
+    }
+    _start_condition.notify_all();
+
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+}
+
+//------------------------------------------------------------------------------
+std::size_t thread_pool::default_num_threads()
+{
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    return num_threads > 1 ? num_threads - 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+void thread_pool::run(job_func func, void* context, std::size_t count, std::size_t grain_size)
+{
+    grain_size = std::max<std::size_t>(grain_size, 1);
+
+    // run small jobs and nested jobs on the calling thread
+    if (!_threads.size() || count <= grain_size || in_job) {
+        func(context, 0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(_run_mutex);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _job = {func, context, count, grain_size};
+        _next = 0;
+        _num_busy = _threads.size();
+        ++_generation;
+    }
+    _start_condition.notify_all();
+
+    execute();
+
+    // wait for workers to finish their last chunk
+    std::unique_lock<std::mutex> lock(_mutex);
+    _finish_condition.wait(lock, [this]() {
+        return _num_busy == 0;
+    });
+}
+
+//------------------------------------------------------------------------------
+void thread_pool::execute()
+{
+    in_job = true;
+    for (;;) {
+        std::size_t begin = _next.fetch_add(_job.grain_size);
+        if (begin >= _job.count) {
+            break;
+        }
+        _job.func(_job.context, begin, std::min(begin + _job.grain_size, _job.count));
+    }
+    in_job = false;
+}
+
+//------------------------------------------------------------------------------
+void thread_pool::worker()
+{
+    uint64_t generation = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _start_condition.wait(lock, [this, generation]() {
+                return _shutdown || _generation != generation;
+            });
+
+            if (_shutdown) {
+                return;
+            }
+            generation = _generation;
+        }
+
+        execute();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            assert(_num_busy > 0);
+            if (--_num_busy == 0) {
+                _finish_condition.notify_one();
+            }
+        }
+    }
+}
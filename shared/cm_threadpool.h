@@ -0,0 +1,86 @@
+// cm_threadpool.h
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//------------------------------------------------------------------------------
+/*
+    Persistent pool of worker threads for data-parallel loops
+
+    Workers sleep until `parallel_for` is called and then take chunks of the
+    index range from a shared counter. The calling thread also executes chunks
+    and blocks until the entire range has been processed, so the order in which
+    indices are processed is unspecified but all side effects are complete when
+    `parallel_for` returns. Nested calls from within a job run serially.
+*/
+class thread_pool
+{
+public:
+    //! Create a pool with `num_threads` worker threads in addition to the
+    //! thread which calls `parallel_for`.
+    explicit thread_pool(std::size_t num_threads = default_num_threads());
+    ~thread_pool();
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+
+    //! Number of threads that execute jobs, including the calling thread
+    std::size_t size() const { return _threads.size() + 1; }
+
+    //! Call `fn(index)` for every index in [0, count) using all threads in
+    //! the pool, indices are assigned to threads in chunks of `grain_size`.
+    template<typename Fn> void parallel_for(std::size_t count, Fn&& fn, std::size_t grain_size = 1);
+
+    //! One fewer than the number of hardware threads
+    static std::size_t default_num_threads();
+
+protected:
+    using job_func = void (*)(void* context, std::size_t begin, std::size_t end);
+
+    struct job
+    {
+        job_func func;
+        void* context;
+        std::size_t count;
+        std::size_t grain_size;
+    };
+
+    std::vector<std::thread> _threads;
+
+    //! Serializes calls to `run` from different threads
+    std::mutex _run_mutex;
+
+    std::mutex _mutex;
+    std::condition_variable _start_condition;
+    std::condition_variable _finish_condition;
+
+    job _job;
+    uint64_t _generation;
+    std::size_t _num_busy;
+    bool _shutdown;
+
+    std::atomic<std::size_t> _next;
+
+protected:
+    void run(job_func func, void* context, std::size_t count, std::size_t grain_size);
+    void execute();
+    void worker();
+};
+
+//------------------------------------------------------------------------------
+template<typename Fn> void thread_pool::parallel_for(std::size_t count, Fn&& fn, std::size_t grain_size)
+{
+    run([](void* context, std::size_t begin, std::size_t end) {
+            for (std::size_t ii = begin; ii < end; ++ii) {
+                (*static_cast<std::remove_reference_t<Fn>*>(context))(ii);
+            }
+        }, const_cast<void*>(static_cast<void const*>(&fn)), count, grain_size);
+}
@@ -6,6 +6,8 @@
 #include <cmath>
 #include <algorithm>
 
+using std::isnan;
+
 class vec2;
 class vec3;
 class vec4;
@@ -31,7 +33,7 @@ public:
     bool operator==(vec2 const& V) const { return x == V.x && y == V.y; }
     bool operator!=(vec2 const& V) const { return x != V.x || y != V.y; }
     constexpr float operator[](std::size_t idx) const { return (&x)[idx]; }
-    float& operator[](std::size_t idx) { return (&x)[idx]; }
+    constexpr float& operator[](std::size_t idx) { return (&x)[idx]; }
     operator float*() { return &x; }
     operator float const*() const { return &x; }
 
@@ -99,7 +101,7 @@ public:
     bool operator==(vec3 const& V) const {return x == V.x && y == V.y && z == V.z; }
     bool operator!=(vec3 const& V) const {return x != V.x || y != V.y || z != V.z; }
     constexpr float operator[](std::size_t idx) const { return (&x)[idx]; }
-    float& operator[](std::size_t idx) { return (&x)[idx]; }
+    constexpr float& operator[](std::size_t idx) { return (&x)[idx]; }
     operator float*() { return &x; }
     operator float const*() const { return &x; }
 
@@ -169,7 +171,7 @@ public:
     bool operator==(vec4 const& V) const { return x==V.x && y==V.y && z==V.z && w==V.w; }
     bool operator!=(vec4 const& V) const { return x!=V.x || y!=V.y || z!=V.z || w!=V.w; }
     constexpr float operator[](std::size_t idx) const { return (&x)[idx]; }
-    float& operator[](std::size_t idx) { return (&x)[idx]; }
+    constexpr float& operator[](std::size_t idx) { return (&x)[idx]; }
     operator float*() { return &x; }
     operator float const*() const { return &x; }
 
@@ -237,7 +239,7 @@ public:
     bool operator==(vec2i const& V) const { return x == V.x && y == V.y; }
     bool operator!=(vec2i const& V) const { return x != V.x || y != V.y; }
     constexpr int operator[](std::size_t idx) const { return (&x)[idx]; }
-    int& operator[](std::size_t idx) { return (&x)[idx]; }
+    constexpr int& operator[](std::size_t idx) { return (&x)[idx]; }
     operator int*() { return &x; }
     operator int const*() const { return &x; }
 
@@ -374,19 +376,19 @@ constexpr vec3 vec3_zero = vec3(0,0,0);
 constexpr vec4 vec4_zero = vec4(0,0,0,0);
 
 //------------------------------------------------------------------------------
-template<> inline bool isnan<vec2>(vec2 v)
+inline bool isnan(vec2 v)
 {
     return isnan(v[0]) || isnan(v[1]);
 }
 
 //------------------------------------------------------------------------------
-template<> inline bool isnan<vec3>(vec3 v)
+inline bool isnan(vec3 v)
 {
     return isnan(v[0]) || isnan(v[1]) || isnan(v[2]);
 }
 
 //------------------------------------------------------------------------------
-template<> inline bool isnan<vec4>(vec4 v)
+inline bool isnan(vec4 v)
 {
     return isnan(v[0]) || isnan(v[1]) || isnan(v[2]) || isnan(v[3]);
 }
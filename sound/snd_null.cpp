@@ -0,0 +1,69 @@
+// snd_null.cpp
+//
+
+#include "cm_sound.h"
+
+#include <map>
+#include <mutex>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+//------------------------------------------------------------------------------
+/*
+    Sound system without an audio device for the dedicated server. Sound
+    indices are shared over the network so sounds are still assigned indices
+    in the order that they are loaded, but no sound data is loaded or played.
+*/
+class null_system : public sound::system
+{
+public:
+    virtual result on_create(HWND) override { return result::success; }
+    virtual void on_destroy() override {}
+
+    virtual void update() override {}
+
+    virtual void set_listener(vec3, vec3, vec3, vec3) override {}
+
+    virtual result play(sound::asset, vec3, float, float) override { return result::success; }
+
+    virtual sound::channel* allocate_channel() override { return nullptr; }
+    virtual void free_channel(sound::channel*) override {}
+
+    virtual sound::asset load_sound(string::view filename) override {
+        // sounds can be loaded by worlds running on different threads
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto it = _sounds_by_name.find(filename);
+        if (it != _sounds_by_name.cend()) {
+            return it->second;
+        }
+
+        auto asset = static_cast<sound::asset>(_sounds_by_name.size() + 1);
+        _sounds_by_name[string::buffer(filename)] = asset;
+        return asset;
+    }
+
+protected:
+    std::mutex _mutex;
+    std::map<string::buffer, sound::asset> _sounds_by_name;
+};
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+sound::system* pSound = nullptr;
+
+//------------------------------------------------------------------------------
+result sound::system::create()
+{
+    pSound = new null_system;
+    return result::success;
+}
+
+//------------------------------------------------------------------------------
+void sound::system::destroy()
+{
+    delete pSound;
+    pSound = nullptr;
+}
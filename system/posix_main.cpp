@@ -0,0 +1,87 @@
+// posix_main.cpp
+//
+
+#include "precompiled.h"
+#pragma hdrstop
+
+#include "g_dedicated.h"
+
+#include <csignal>
+#include <ctime>
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+namespace {
+
+volatile std::sig_atomic_t quit_requested = 0;
+
+//------------------------------------------------------------------------------
+void signal_handler(int /*signal*/)
+{
+    quit_requested = 1;
+}
+
+//------------------------------------------------------------------------------
+int64_t get_microseconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+} // anonymous namespace
+
+//------------------------------------------------------------------------------
+time_value time_value::current()
+{
+    static int64_t offset = get_microseconds();
+    return time_value::from_microseconds(get_microseconds() - offset);
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    std::string cmdline;
+    for (int ii = 1; ii < argc; ++ii) {
+        cmdline += (ii > 1 ? " " : "");
+        cmdline += argv[ii];
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    srand(static_cast<unsigned int>(get_microseconds()));
+
+    config::system config;
+    config.init();
+
+    // sound indices are still assigned by the null sound system
+    sound::system::create();
+
+    int exit_code = 0;
+    {
+        game::dedicated_server server;
+
+        if (succeeded(server.init(string::view(cmdline.c_str())))) {
+            time_value previous_time = time_value::current();
+
+            while (!quit_requested) {
+                time_value current_time = time_value::current();
+                server.run_frame(current_time - previous_time);
+                previous_time = current_time;
+
+                // block until packets arrive, interrupted by signals
+                server.wait();
+            }
+        } else {
+            exit_code = 1;
+        }
+
+        server.shutdown();
+    }
+
+    sound::system::destroy();
+    config.shutdown();
+
+    return exit_code;
+}